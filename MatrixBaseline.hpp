@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "MatrixBuild.hpp"
+
+// Results of earlier runs, kept in a local tab-separated file so a rebuilt binary can be
+// compared with the one before it. One line per run:
+//
+//   fingerprint <TAB> configuration <TAB> type <TAB> N <TAB> product <TAB> s1,s2,... <TAB> build
+//
+// Lines are only ever appended; the last line for a key is its baseline.
+
+// CPU model, hardware threads and selected kernel ISA: timings are only comparable between
+// runs that agree on these. The compiler is deliberately left out so that a compiler
+// change is something the comparison can measure.
+inline std::string machineFingerprint() {
+    std::string model = "unknown cpu";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+            model = line.substr(line.find(':') + 1);
+            model.erase(0, model.find_first_not_of(' '));
+            break;
+        }
+    }
+    return model + " | " + std::to_string(std::thread::hardware_concurrency()) + " threads | " + matrixIsaName();
+}
+
+struct BaselineKey {
+    std::string fingerprint;
+    std::string config;     // driver options that change the timing, e.g. kernel and backend
+    std::string type;
+    size_t n;
+    std::string product;    // RC, RR, ...
+
+    bool operator<(const BaselineKey& other) const {
+        return std::tie(fingerprint, config, type, n, product) <
+               std::tie(other.fingerprint, other.config, other.type, other.n, other.product);
+    }
+};
+
+// Samples of the last stored run per key; a missing file is an empty store
+inline std::map<BaselineKey, std::vector<double>> loadBaselines(const std::string& path) {
+    std::map<BaselineKey, std::vector<double>> store;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 6) {
+            continue;
+        }
+        BaselineKey key{fields[0], fields[1], fields[2], std::stoul(fields[3]), fields[4]};
+        std::vector<double> samples;
+        std::stringstream values(fields[5]);
+        while (std::getline(values, field, ',')) {
+            samples.push_back(std::stod(field));
+        }
+        store[key] = samples;
+    }
+    return store;
+}
+
+inline void appendBaseline(const std::string& path, const BaselineKey& key, const std::vector<double>& samples) {
+    std::ofstream out(path, std::ios::app);
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    out << key.fingerprint << '\t' << key.config << '\t' << key.type << '\t' << key.n << '\t' << key.product << '\t';
+    out << std::setprecision(9);
+    for (size_t i = 0; i < samples.size(); i++) {
+        out << (i ? "," : "") << samples[i];
+    }
+    out << '\t' << MATRIX_BUILD_COMPILER << ' ' << MATRIX_BUILD_FLAGS << '\n';
+}
+
+namespace detail {
+
+// Continued fraction of the regularized incomplete beta function (modified Lentz)
+inline double betaContinuedFraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1, d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (std::abs(d) < tiny ? tiny : d);
+    double h = d;
+    for (int m = 1; m <= 200; m++) {
+        for (int step = 0; step < 2; step++) {
+            double num = step == 0 ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                   : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1 + num * d;
+            d = 1 / (std::abs(d) < tiny ? tiny : d);
+            c = 1 + num / c;
+            c = std::abs(c) < tiny ? tiny : c;
+            h *= d * c;
+            if (step == 1 && std::abs(d * c - 1) < 1e-12) {
+                return h;
+            }
+        }
+    }
+    return h;
+}
+
+inline double incompleteBeta(double a, double b, double x) {
+    if (x <= 0) {
+        return 0;
+    }
+    if (x >= 1) {
+        return 1;
+    }
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) {
+        return front * betaContinuedFraction(a, b, x) / a;
+    }
+    return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+}
+
+}  // namespace detail
+
+inline void meanAndVariance(const std::vector<double>& samples, double& mean, double& variance) {
+    mean = 0;
+    for (double s : samples) {
+        mean += s / samples.size();
+    }
+    variance = 0;
+    for (double s : samples) {
+        variance += (s - mean) * (s - mean);
+    }
+    variance = samples.size() > 1 ? variance / (samples.size() - 1) : 0;
+}
+
+// Two-sided p-value of Welch's t-test for equal means; NaN with fewer than two samples on
+// either side
+inline double welchPValue(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() < 2 || b.size() < 2) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double meanA, varA, meanB, varB;
+    meanAndVariance(a, meanA, varA);
+    meanAndVariance(b, meanB, varB);
+    const double sa = varA / a.size(), sb = varB / b.size();
+    if (sa + sb == 0) {
+        return meanA == meanB ? 1.0 : 0.0;
+    }
+    const double t = (meanA - meanB) / std::sqrt(sa + sb);
+    const double df = (sa + sb) * (sa + sb) / (sa * sa / (a.size() - 1) + sb * sb / (b.size() - 1));
+    return detail::incompleteBeta(df / 2, 0.5, df / (df + t * t));
+}
+
+enum class BaselineVerdict { Unchanged, Faster, Slower, Regression, Untested };
+
+struct BaselineComparison {
+    double baselineMean = 0;
+    double currentMean = 0;
+    double change = 0;      // relative change of the mean time, +0.05 is 5% slower
+    double pValue = 0;
+    BaselineVerdict verdict = BaselineVerdict::Untested;
+};
+
+// Significant at alpha: Slower or Faster; a significant slowdown above threshold (a
+// fraction, 0.05 = 5%) is a Regression. Untested when either side has fewer than two samples.
+inline BaselineComparison compareToBaseline(const std::vector<double>& baseline, const std::vector<double>& current,
+                                            double threshold, double alpha = 0.05) {
+    BaselineComparison result;
+    double variance;
+    meanAndVariance(baseline, result.baselineMean, variance);
+    meanAndVariance(current, result.currentMean, variance);
+    result.change = result.currentMean / result.baselineMean - 1;
+    result.pValue = welchPValue(baseline, current);
+    if (std::isnan(result.pValue)) {
+        result.verdict = BaselineVerdict::Untested;
+    } else if (result.pValue >= alpha) {
+        result.verdict = BaselineVerdict::Unchanged;
+    } else if (result.change > threshold) {
+        result.verdict = BaselineVerdict::Regression;
+    } else {
+        result.verdict = result.change > 0 ? BaselineVerdict::Slower : BaselineVerdict::Faster;
+    }
+    return result;
+}
+
+inline const char* baselineVerdictName(BaselineVerdict verdict) {
+    switch (verdict) {
+        case BaselineVerdict::Unchanged:
+            return "no significant change";
+        case BaselineVerdict::Faster:
+            return "faster";
+        case BaselineVerdict::Slower:
+            return "slower, within threshold";
+        case BaselineVerdict::Regression:
+            return "REGRESSION";
+        case BaselineVerdict::Untested:
+            break;
+    }
+    return "too few rounds to test";
+}
+
+inline void printBaselineComparison(std::ostream& os, const std::string& product, const BaselineComparison& result) {
+    os << "Baseline " << product << ": " << result.baselineMean << " -> " << result.currentMean << " seconds ("
+       << std::showpos << std::fixed << std::setprecision(1) << result.change * 100 << "%" << std::noshowpos
+       << std::defaultfloat << std::setprecision(6);
+    if (!std::isnan(result.pValue)) {
+        os << ", p=" << result.pValue;
+    }
+    os << "): " << baselineVerdictName(result.verdict) << std::endl;
+}
@@ -5,6 +5,11 @@
 #include <type_traits>
 #include <cxxabi.h>
 #include <future>
+#include <vector>
+#include "MatrixGemm.hpp"
+#include "MatrixCoroutine.hpp"
+#include "MatrixIO.hpp"
+#include "MatrixBuild.hpp"
 
 template <typename T>
 T** allocateMatrix(size_t size);
@@ -13,31 +18,40 @@ template <typename T>
 void deallocateMatrix(T** matrix, size_t size);
 
 template <typename T>
-void RandomElements(T** Arr, const size_t NUM_ARR);
+void RandomElements(T** Arr, const size_t NUM_ARR, std::random_device::result_type seed = std::random_device{}());
 
 template <typename T>
 void Print_arr(T** Arr, const size_t NUM_ARR);
 
 template <typename T>
-void RC_Product(T** A, T** B, T** C, const size_t NUM_ARR);
-
-template <typename T>
-void RR_Product(T** A, T** B, T** C, const size_t NUM_ARR);
-
-template <typename Func, typename T>
-double measureExecutionTime(Func func, T** A, T** B, T** C, const size_t NUM_ARR);
+double measureExecutionTime(gemm::Context& ctx, T** A, T** B, T** C, const size_t NUM_ARR, gemm::Op opB);
 
 void printTimeResult(const double* RC_Time, const double* RR_Time, const int ROUND);
 
 template <typename T>
 std::string demangleTypeName();
 
+struct AsyncOptions {
+    int threads = 8;        // --threads=<n>: threads for the backend comparison
+    gemm::Algorithm kernel = gemm::Algorithm::Naive;   // --kernel=naive|tuned|blocked|auto
+    size_t items = 4;       // --items=<n>: (A, B) pairs in the load-and-multiply stream, 0 = skip it
+    std::string loadA;      // --a=<file>, --b=<file>: the stream's loader reads these for every item
+    std::string loadB;
+};
+
+bool parseOptions(int argc, char* argv[], int first, AsyncOptions& opts);
+
+template <typename MyType>
+void runTest(const size_t NUM_ARR, const int ROUND, const AsyncOptions& opts);
+
 template <typename MyType>
-void runTest(const size_t NUM_ARR, const int ROUND);
+void runStreamTest(const size_t NUM_ARR, const int ROUND, const AsyncOptions& opts);
 
 int main(int argc, char* argv[]) {
-    if (argc < 4 || argc > 4) {
-        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round>\n";
+    AsyncOptions opts;
+    if (argc < 4 || !parseOptions(argc, argv, 4, opts)) {
+        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round> [--threads=<n>] [--kernel=naive|tuned|blocked|auto]\n";
+        std::cerr << "       [--items=<n>] [--a=<file>] [--b=<file>]\n";
         return 1;
     }
 
@@ -45,42 +59,78 @@ int main(int argc, char* argv[]) {
     const size_t NUM_ARR = static_cast<size_t>(std::stoul(argv[2]));
     const int round = std::stoi(argv[3]);
 
-    if (mtype == "int") {
-        runTest<int>(NUM_ARR, round);
-    } else if (mtype == "2long") {
-        runTest<long long>(NUM_ARR, round);
-    } else if (mtype == "float") {
-        runTest<float>(NUM_ARR, round);
-    } else if (mtype == "double") {
-        runTest<double>(NUM_ARR, round);
-    } else {
-        std::cerr << "Unsupported type: " << mtype << "\n";
+    printBuildInfo(std::cout);
+
+    try {
+        if (mtype == "int") {
+            runTest<int>(NUM_ARR, round, opts);
+        } else if (mtype == "2long") {
+            runTest<long long>(NUM_ARR, round, opts);
+        } else if (mtype == "float") {
+            runTest<float>(NUM_ARR, round, opts);
+        } else if (mtype == "double") {
+            runTest<double>(NUM_ARR, round, opts);
+        } else {
+            std::cerr << "Unsupported type: " << mtype << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
 
     return 0;
 }
+
+bool parseOptions(int argc, char* argv[], int first, AsyncOptions& opts) {
+    for (int i = first; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) {
+            opts.threads = std::stoi(arg.substr(10));
+        } else if (arg.rfind("--items=", 0) == 0) {
+            opts.items = std::stoul(arg.substr(8));
+        } else if (arg.rfind("--a=", 0) == 0) {
+            opts.loadA = arg.substr(4);
+        } else if (arg.rfind("--b=", 0) == 0) {
+            opts.loadB = arg.substr(4);
+        } else if (arg.rfind("--kernel=", 0) == 0) {
+            if (!gemm::parseAlgorithm(arg.substr(9), opts.kernel)) {
+                std::cerr << "Unknown kernel: " << arg.substr(9) << "\n";
+                return false;
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+    if (opts.threads <= 0) {
+        std::cerr << "Threads must be positive\n";
+        return false;
+    }
+    return true;
+}
+// Rows share one contiguous block so the matrix can be handed to gemm as a view
 template <typename T>
 T** allocateMatrix(size_t size) {
     T** matrix = new T*[size];
+    T* block = new T[size * size];
     for (size_t i = 0; i < size; i++) {
-        matrix[i] = new T[size];
+        matrix[i] = block + i * size;
     }
     return matrix;
 }
 
 template <typename T>
 void deallocateMatrix(T** matrix, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        delete[] matrix[i];
+    if (size > 0) {
+        delete[] matrix[0];
     }
     delete[] matrix;
 }
 
 template <typename T>
-void RandomElements(T** Arr, const size_t NUM_ARR) {
-    std::random_device rd;
-    std::default_random_engine gen(rd());
+void RandomElements(T** Arr, const size_t NUM_ARR, std::random_device::result_type seed) {
+    std::default_random_engine gen(seed);
     for (size_t i = 0; i < NUM_ARR; i++) {
         for (size_t j = 0; j < NUM_ARR; j++) {
             if (std::is_integral<T>::value) {
@@ -114,37 +164,18 @@ void Print_arr(T** Arr, const size_t NUM_ARR) {
     }
 }
 
+// One C = A * B (opB = Trans: the RR product) as a single std::async task of the gemm library
 template <typename T>
-void RC_Product(T** A, T** B, T** C, const size_t NUM_ARR) {
-    for (size_t i = 0; i < NUM_ARR; i++) {
-        for (size_t j = 0; j < NUM_ARR; j++) {
-            T sum = 0;
-            for (size_t k = 0; k < NUM_ARR; k++) {
-                sum += A[i][k] * B[k][j];
-            }
-            C[i][j] = sum;
-        }
-    }
-}
+double measureExecutionTime(gemm::Context& ctx, T** A, T** B, T** C, const size_t NUM_ARR, gemm::Op opB) {
+    gemm::Options<T> options;
+    options.opB = opB;
+    options.algorithm = gemm::Algorithm::Naive;
+    options.backend = gemm::Backend::Async;
+    options.threads = 1;
 
-template <typename T>
-void RR_Product(T** A, T** B, T** C, const size_t NUM_ARR) {
-    for (size_t i = 0; i < NUM_ARR; i++) {
-        for (size_t j = 0; j < NUM_ARR; j++) {
-            T sum = 0;
-            for (size_t k = 0; k < NUM_ARR; k++) {
-                sum += A[i][k] * B[j][k];
-            }
-            C[i][j] = sum;
-        }
-    }
-}
-
-template <typename Func, typename T>
-double measureExecutionTime(Func func, T** A, T** B, T** C, const size_t NUM_ARR) {
-    auto future = std::async(std::launch::async, func, A, B, C, NUM_ARR);
     auto start_time = std::chrono::high_resolution_clock::now();
-    future.get();
+    gemm::gemm<T>(ctx, gemm::view(A, NUM_ARR, NUM_ARR), gemm::view(B, NUM_ARR, NUM_ARR), gemm::view(C, NUM_ARR, NUM_ARR),
+                  options);
     auto end_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> duration = end_time - start_time;
     return duration.count();
@@ -175,8 +206,25 @@ std::string demangleTypeName() {
     return result;
 }
 
+// RC product with one backend of the library at opts.threads
+template <typename T>
+double measureBackend(gemm::Context& ctx, T** A, T** B, T** C, const size_t NUM_ARR, const AsyncOptions& opts,
+                      gemm::Backend backend) {
+    gemm::Options<T> options;
+    options.algorithm = opts.kernel;
+    options.backend = backend;
+    options.threads = opts.threads;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    gemm::gemm<T>(ctx, gemm::view(A, NUM_ARR, NUM_ARR), gemm::view(B, NUM_ARR, NUM_ARR), gemm::view(C, NUM_ARR, NUM_ARR),
+                  options);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    return duration.count();
+}
+
 template <typename MyType>
-void runTest(const size_t NUM_ARR, const int ROUND) {
+void runTest(const size_t NUM_ARR, const int ROUND, const AsyncOptions& opts) {
     MyType** A = allocateMatrix<MyType>(NUM_ARR);
     MyType** B = allocateMatrix<MyType>(NUM_ARR);
     MyType** C_RC = allocateMatrix<MyType>(NUM_ARR);
@@ -184,6 +232,13 @@ void runTest(const size_t NUM_ARR, const int ROUND) {
 
     double RC_Time[ROUND], RR_Time[ROUND];
     bool swap_flag = false;
+    gemm::Context ctx(1);
+    // The same inputs again through std::async, pthread and coroutine tiles on opts.threads
+    const gemm::Backend backends[] = {gemm::Backend::Async, gemm::Backend::Pthread, gemm::Backend::Coroutine};
+    double Backend_Time[3] = {0, 0, 0};
+    gemm::Context backendCtx(opts.threads);
+    MyType** C_Backend = allocateMatrix<MyType>(NUM_ARR);
+    double backendDiff = 0;
 
     std::cout << "TESTING {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>() << "}" << std::endl;
 
@@ -192,22 +247,181 @@ void runTest(const size_t NUM_ARR, const int ROUND) {
         RandomElements(B, NUM_ARR);
 
         if (swap_flag) {
-            RC_Time[i] = measureExecutionTime(RC_Product<MyType>, A, B, C_RC, NUM_ARR);
-            RR_Time[i] = measureExecutionTime(RR_Product<MyType>, A, B, C_RR, NUM_ARR);
+            RC_Time[i] = measureExecutionTime(ctx, A, B, C_RC, NUM_ARR, gemm::Op::None);
+            RR_Time[i] = measureExecutionTime(ctx, A, B, C_RR, NUM_ARR, gemm::Op::Trans);
         } else {
-            RR_Time[i] = measureExecutionTime(RR_Product<MyType>, A, B, C_RR, NUM_ARR);
-            RC_Time[i] = measureExecutionTime(RC_Product<MyType>, A, B, C_RC, NUM_ARR);
+            RR_Time[i] = measureExecutionTime(ctx, A, B, C_RR, NUM_ARR, gemm::Op::Trans);
+            RC_Time[i] = measureExecutionTime(ctx, A, B, C_RC, NUM_ARR, gemm::Op::None);
         }
         std::cout << "Round " << i + 1 << ":" << std::endl;
         std::cout << "Execution Time RC product: " << RC_Time[i] << " seconds" << std::endl;
         std::cout << "Execution Time RR product: " << RR_Time[i] << " seconds" << std::endl;
         swap_flag = !swap_flag;
+
+        for (int b = 0; b < 3; b++) {
+            double elapsed = measureBackend(backendCtx, A, B, C_Backend, NUM_ARR, opts, backends[b]);
+            Backend_Time[b] += elapsed / ROUND;
+            for (size_t r = 0; r < NUM_ARR; r++) {
+                for (size_t c = 0; c < NUM_ARR; c++) {
+                    double diff = std::abs(static_cast<double>(C_Backend[r][c]) - static_cast<double>(C_RC[r][c]));
+                    backendDiff = std::max(backendDiff, diff / std::max(1.0, std::abs(static_cast<double>(C_RC[r][c]))));
+                }
+            }
+            std::cout << "Execution Time RC product (" << gemm::backendName(backends[b]) << ", " << opts.threads
+                      << " threads): " << elapsed << " seconds" << std::endl;
+        }
     }
 
     printTimeResult(RC_Time, RR_Time, ROUND);
+    for (int b = 0; b < 3; b++) {
+        std::cout << "Average Execution Time for RC product (" << gemm::backendName(backends[b]) << ", " << opts.threads
+                  << " threads): " << Backend_Time[b] << " seconds" << std::endl;
+    }
+    std::cout << "Speedup coroutine over async: " << Backend_Time[0] / Backend_Time[2] << std::endl;
+    std::cout << "Speedup coroutine over pthread: " << Backend_Time[1] / Backend_Time[2] << std::endl;
+    std::cout << "Max relative difference: " << backendDiff << std::endl;
+    deallocateMatrix(C_Backend, NUM_ARR);
 
     deallocateMatrix(A, NUM_ARR);
     deallocateMatrix(B, NUM_ARR);
     deallocateMatrix(C_RC, NUM_ARR);
     deallocateMatrix(C_RR, NUM_ARR);
-}
\ No newline at end of file
+
+    if (opts.items > 0) {
+        runStreamTest<MyType>(NUM_ARR, ROUND, opts);
+    }
+}
+
+// One (A, B) pair of the load-and-multiply stream
+template <typename T>
+struct StreamItem {
+    T** A = nullptr;
+    T** B = nullptr;
+    T** C = nullptr;
+    unsigned seed = 0;     // of the generated elements, so both passes multiply the same pairs
+    double expected = 0;   // checksum of the one-after-another pass
+    double checksum = 0;
+};
+
+// The blocking loader: the --a/--b files when given, otherwise random elements from the
+// item's seed
+template <typename T>
+void loadItem(StreamItem<T>& item, const size_t NUM_ARR, const AsyncOptions& opts) {
+    if (opts.loadA.empty()) {
+        RandomElements(item.A, NUM_ARR, item.seed);
+    } else {
+        loadMatrix(opts.loadA, item.A, NUM_ARR, NUM_ARR);
+    }
+    if (opts.loadB.empty()) {
+        RandomElements(item.B, NUM_ARR, item.seed + 1);
+    } else {
+        loadMatrix(opts.loadB, item.B, NUM_ARR, NUM_ARR);
+    }
+}
+
+template <typename T>
+double checksum(T** C, const size_t NUM_ARR) {
+    double sum = 0;
+    for (size_t i = 0; i < NUM_ARR; i++) {
+        for (size_t j = 0; j < NUM_ARR; j++) {
+            sum += static_cast<double>(C[i][j]);
+        }
+    }
+    return sum;
+}
+
+// Rows [begin, end) of one item's product, run on whichever thread picks the tile up
+template <typename T>
+gemm::Task<void> productTile(gemm::Context& ctx, StreamItem<T>& item, const size_t NUM_ARR, size_t begin, size_t end,
+                             const gemm::Options<T>& options) {
+    gemm::gemm<T>(ctx, gemm::view(item.A[begin], end - begin, NUM_ARR, NUM_ARR), gemm::view(item.B, NUM_ARR, NUM_ARR),
+                  gemm::view(item.C[begin], end - begin, NUM_ARR, NUM_ARR), options);
+    co_return;
+}
+
+template <typename T>
+std::vector<gemm::Task<void>> productTiles(gemm::Context& ctx, StreamItem<T>& item, const size_t NUM_ARR,
+                                           const size_t tiles, const gemm::Options<T>& options) {
+    std::vector<gemm::Task<void>> tasks;
+    for (size_t t = 0; t < tiles; t++) {
+        tasks.push_back(productTile(ctx, item, NUM_ARR, NUM_ARR * t / tiles, NUM_ARR * (t + 1) / tiles, options));
+    }
+    return tasks;
+}
+
+// Load on the I/O thread, then multiply as tiles on the workers; the next item's load
+// overlaps this one's tiles
+template <typename T>
+gemm::Task<void> streamItem(gemm::Context& ctx, StreamItem<T>& item, const size_t NUM_ARR, const size_t tiles,
+                            const gemm::Options<T>& options, const AsyncOptions& opts) {
+    gemm::Scheduler& scheduler = ctx.scheduler();
+    co_await scheduler.offload([&]() { loadItem(item, NUM_ARR, opts); });
+    co_await gemm::when_all(scheduler, productTiles(ctx, item, NUM_ARR, tiles, options));
+    item.checksum = checksum(item.C, NUM_ARR);
+}
+
+// --items (A, B) pairs are loaded and multiplied twice: one after another, each product as
+// coroutine tiles, and all at once, so one item's loading overlaps the others' tiles. Both
+// passes load the same pairs and their checksums are compared.
+template <typename MyType>
+void runStreamTest(const size_t NUM_ARR, const int ROUND, const AsyncOptions& opts) {
+    gemm::Context ctx(opts.threads);
+    gemm::Scheduler& scheduler = ctx.scheduler();
+    // Each tile runs serially on the thread that took it
+    gemm::Options<MyType> options;
+    options.algorithm = opts.kernel;
+    options.backend = gemm::Backend::Pthread;
+    options.threads = 1;
+    const size_t tiles = std::min(NUM_ARR, static_cast<size_t>(opts.threads) * 64);
+
+    std::vector<StreamItem<MyType>> items(opts.items);
+    for (size_t i = 0; i < items.size(); i++) {
+        items[i].seed = static_cast<unsigned>(2 * i + 1);
+    }
+    for (StreamItem<MyType>& item : items) {
+        item.A = allocateMatrix<MyType>(NUM_ARR);
+        item.B = allocateMatrix<MyType>(NUM_ARR);
+        item.C = allocateMatrix<MyType>(NUM_ARR);
+    }
+
+    std::cout << "TESTING LOAD AND MULTIPLY {items:" << opts.items << ", tiles per item:" << tiles
+              << ", threads:" << scheduler.size() << "}" << std::endl;
+    double serialAvg = 0, overlappedAvg = 0, streamDiff = 0;
+    for (int r = 0; r < ROUND; r++) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        for (StreamItem<MyType>& item : items) {
+            loadItem(item, NUM_ARR, opts);
+            gemm::sync_wait(scheduler, gemm::when_all(scheduler, productTiles(ctx, item, NUM_ARR, tiles, options)));
+            item.expected = checksum(item.C, NUM_ARR);
+        }
+        auto middle_time = std::chrono::high_resolution_clock::now();
+        std::vector<gemm::Task<void>> streams;
+        for (StreamItem<MyType>& item : items) {
+            streams.push_back(streamItem(ctx, item, NUM_ARR, tiles, options, opts));
+        }
+        gemm::sync_wait(scheduler, gemm::when_all(scheduler, std::move(streams)));
+        auto end_time = std::chrono::high_resolution_clock::now();
+        for (const StreamItem<MyType>& item : items) {
+            streamDiff = std::max(streamDiff, std::abs(item.checksum - item.expected) / std::max(1.0, std::abs(item.expected)));
+        }
+
+        double serial = std::chrono::duration<double>(middle_time - start_time).count();
+        double overlapped = std::chrono::duration<double>(end_time - middle_time).count();
+        serialAvg += serial / ROUND;
+        overlappedAvg += overlapped / ROUND;
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        std::cout << "Execution Time load then multiply: " << serial << " seconds" << std::endl;
+        std::cout << "Execution Time overlapped: " << overlapped << " seconds (" << opts.items * tiles
+                  << " tiles in flight)" << std::endl;
+    }
+    std::cout << "Average Execution Time for load then multiply: " << serialAvg << " seconds" << std::endl;
+    std::cout << "Average Execution Time for overlapped: " << overlappedAvg << " seconds" << std::endl;
+    std::cout << "Speedup: " << serialAvg / overlappedAvg << std::endl;
+    std::cout << "Max relative difference of checksums: " << streamDiff << std::endl;
+
+    for (StreamItem<MyType>& item : items) {
+        deallocateMatrix(item.A, NUM_ARR);
+        deallocateMatrix(item.B, NUM_ARR);
+        deallocateMatrix(item.C, NUM_ARR);
+    }
+}
@@ -0,0 +1,206 @@
+#include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MatrixThreadPool.hpp"
+#include "MatrixBuild.hpp"
+
+// Reference scheduler: the same run() contract as ThreadPool with one mutex/condvar queue
+// of tasks and a mutex-protected completion count
+class MutexTaskPool {
+public:
+    explicit MutexTaskPool(int threads);
+    ~MutexTaskPool();
+
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct Task {
+        const std::function<void(size_t)>* body;
+        size_t index;
+        size_t* remaining;
+    };
+
+    bool runOne(std::unique_lock<std::mutex>& lock);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::deque<Task> tasks;
+    bool stopping = false;
+};
+
+double measureDispatch(const std::function<void(size_t, const std::function<void(size_t)>&)>& run, size_t tasks,
+                       const std::function<void(size_t)>& work);
+
+void tileWork(double* tile, size_t repeats);
+
+size_t calibrateRepeats(double targetMicros);
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <tasks> <round> [threads]\n";
+        return 1;
+    }
+
+    const size_t tasks = static_cast<size_t>(std::stoul(argv[1]));
+    const int round = std::stoi(argv[2]);
+    const int numThreads = argc == 4 ? std::stoi(argv[3]) : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    printBuildInfo(std::cout);
+    std::cout << "TESTING DISPATCH {tasks:" << tasks << ", threads:" << numThreads << "}" << std::endl;
+
+    ThreadPool lockFree(numThreads);
+    MutexTaskPool locked(numThreads);
+    auto runLockFree = [&lockFree](size_t n, const std::function<void(size_t)>& task) { lockFree.run(n, task); };
+    auto runLocked = [&locked](size_t n, const std::function<void(size_t)>& task) { locked.run(n, task); };
+
+    std::cout << std::setw(10) << "tile us" << std::setw(14) << "serial us" << std::setw(16) << "lock-free us"
+              << std::setw(14) << "mutex us" << std::setw(18) << "lock-free ovh" << std::setw(14) << "mutex ovh"
+              << std::endl;
+
+    // Per-task times, and the overhead: core-time per task minus the work of one task, with
+    // the cores counted as the threads that can actually run at once
+    const int cores = std::min(numThreads, std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    for (double target : {0.0, 1.0, 5.0, 10.0}) {
+        const size_t repeats = target > 0 ? calibrateRepeats(target) : 0;
+        auto work = [repeats](size_t) {
+            thread_local std::vector<double> tile(256, 1.0);
+            if (repeats > 0) {
+                tileWork(tile.data(), repeats);
+            }
+        };
+
+        double serial = 0, lockFreeTime = 0, lockedTime = 0;
+        for (int r = 0; r < round; r++) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < tasks; i++) {
+                work(i);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+            serial += elapsed.count();
+            lockFreeTime += measureDispatch(runLockFree, tasks, work);
+            lockedTime += measureDispatch(runLocked, tasks, work);
+        }
+
+        const double perTask = 1e6 / (static_cast<double>(tasks) * round);
+        const double workUs = serial * perTask;
+        std::cout << std::setw(10) << target << std::setw(14) << workUs << std::setw(16) << lockFreeTime * perTask
+                  << std::setw(14) << lockedTime * perTask << std::setw(18)
+                  << cores * lockFreeTime * perTask - workUs << std::setw(14)
+                  << cores * lockedTime * perTask - workUs << std::endl;
+    }
+    return 0;
+}
+
+MutexTaskPool::MutexTaskPool(int threads) {
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+MutexTaskPool::~MutexTaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Called with the lock held; runs one task without it
+bool MutexTaskPool::runOne(std::unique_lock<std::mutex>& lock) {
+    if (tasks.empty()) {
+        return false;
+    }
+    Task task = tasks.front();
+    tasks.pop_front();
+    lock.unlock();
+    (*task.body)(task.index);
+    lock.lock();
+    if (--*task.remaining == 0) {
+        finished.notify_all();
+    }
+    return true;
+}
+
+void MutexTaskPool::run(size_t count, const std::function<void(size_t)>& task) {
+    size_t remaining = count;
+    for (size_t index = 0; index < count; index++) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back({&task, index, &remaining});
+        wake.notify_one();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (remaining > 0) {
+        if (!runOne(lock)) {
+            finished.wait(lock, [&remaining, this]() { return remaining == 0 || !tasks.empty(); });
+        }
+    }
+}
+
+void MutexTaskPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (stopping) {
+            return;
+        }
+        while (runOne(lock)) {
+        }
+    }
+}
+
+double measureDispatch(const std::function<void(size_t, const std::function<void(size_t)>&)>& run, size_t tasks,
+                       const std::function<void(size_t)>& work) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    run(tasks, work);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    return duration.count();
+}
+
+// A 16 x 16 tile squared in place `repeats` times: cache-resident multiply work with no
+// memory traffic, so the measured time is compute plus scheduling
+void tileWork(double* tile, size_t repeats) {
+    double out[256];
+    for (size_t r = 0; r < repeats; r++) {
+        for (size_t i = 0; i < 16; i++) {
+            for (size_t j = 0; j < 16; j++) {
+                double sum = 0;
+                for (size_t k = 0; k < 16; k++) {
+                    sum += tile[i * 16 + k] * tile[k * 16 + j];
+                }
+                out[i * 16 + j] = sum * (1.0 / 16);
+            }
+        }
+        for (size_t i = 0; i < 256; i++) {
+            tile[i] = out[i];
+        }
+    }
+}
+
+// Tile repeats that take about targetMicros on this core
+size_t calibrateRepeats(double targetMicros) {
+    std::vector<double> tile(256, 1.0);
+    size_t repeats = 1;
+    for (;;) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        tileWork(tile.data(), repeats);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+        if (elapsed.count() >= 1000) {
+            return std::max<size_t>(1, static_cast<size_t>(repeats * targetMicros / elapsed.count()));
+        }
+        repeats *= 2;
+    }
+}
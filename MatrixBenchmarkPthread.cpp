@@ -5,6 +5,28 @@
 #include <type_traits>
 #include <cxxabi.h>
 #include <pthread.h>
+#include <memory>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include "MatrixIO.hpp"
+#include "MatrixSparse.hpp"
+#include "MatrixGemv.hpp"
+#include "MatrixChain.hpp"
+#include "MatrixEpilogue.hpp"
+#include "MatrixGemm.hpp"
+#include "MatrixPipeline.hpp"
+#include "MatrixMorton.hpp"
+#include "MatrixScaling.hpp"
+#include "MatrixBaseline.hpp"
+#include "MatrixInteger.hpp"
+#include "MatrixSemiring.hpp"
+#include "MatrixIncremental.hpp"
+#include "MatrixBuild.hpp"
 
 template <typename T>
 T** allocateMatrix(size_t size);
@@ -16,19 +38,23 @@ template <typename T>
 void RandomElements(T** Arr, const size_t NUM_ARR);
 
 template <typename T>
-void Print_arr(T** Arr, const size_t NUM_ARR);
+void RandomSparseElements(T** Arr, const size_t NUM_ARR, const double density);
 
 template <typename T>
-void* RC_Product(void* arg);
+void Print_arr(T** Arr, const size_t NUM_ARR);
 
-template <typename T>
-void* RR_Product(void* arg);
+template <typename Data>
+double measureThreads(void* (*func)(void*), Data* threadData, const size_t NUM_ROWS, const int numThreads);
 
-template <typename Func, typename T>
-double measureExecutionTime(Func func, T** A, T** B, T** C, const size_t NUM_ARR, const int numThreads);
+template <typename T>
+double measureExecutionTime(gemm::Context& ctx, T** A, T** B, T** C, const size_t NUM_ARR,
+                            const gemm::Options<T>& options);
 
 void printTimeResult(const double* RC_Time, const double* RR_Time, const int ROUND);
 
+template <typename T>
+void* Epilogue_Pass(void* arg);
+
 template <typename T>
 std::string demangleTypeName();
 
@@ -40,51 +66,328 @@ struct ThreadData {
     size_t startRow;
     size_t endRow;
     size_t NUM_ARR;
-};  
+    const Epilogue<T>* ep = nullptr;    // null: plain C = A * B
+};
+
+struct BenchOptions {
+    std::string loadA;      // --a=<file>: use this A instead of random elements
+    std::string loadB;      // --b=<file>: use this B instead of random elements
+    std::string saveC;      // --c=<file>: write the RC result after the last round
+    std::string mode = "dense";     // --mode=dense|sparse|gemv|chain|epilogue|stream|strong|weak|integer|semiring|complex|cache|incremental
+    double density = 0;     // --density=<d>: single sparse density instead of the sweep
+    size_t blockSize = 4;   // --block=<b>: BSR block size
+    int calls = 100;        // --calls=<n>: GEMV calls per round
+    std::vector<size_t> chain;      // --chain=<d0>x<d1>x...: chain shapes, A_i is d(i-1) x d(i)
+    double alpha = 2;       // --alpha=<a>, --beta=<b>: epilogue scalars
+    double beta = 1;
+    Activation act = Activation::ReLU;  // --act=none|relu|gelu
+    gemm::Algorithm kernel = gemm::Algorithm::Naive;   // --kernel=naive|tuned|blocked|auto
+    gemm::Backend backend = gemm::Backend::Pthread;     // --backend=pthread|pool|async|coroutine
+    size_t items = 16;      // --items=<n>: (A, B) pairs per stream round
+    size_t depth = 2;       // --depth=<d>: queue length between stream stages
+    std::string layout = "rowmajor";    // --layout=rowmajor|morton: morton adds the Z-order product
+    size_t tile = 64;       // --tile=<t>: largest Morton tile
+    bool profile = false;   // --profile: per-thread timing and imbalance report for the last round
+    std::string trace;      // --trace=<file.json>: Chrome trace of the last round (implies --profile)
+    std::string baseline;   // --baseline=<file>: compare the dense products with the stored run
+    std::string saveBaseline;   // --save-baseline=<file>: append this run to the store
+    double threshold = 5;   // --threshold=<pct>: slowdown that counts as a regression
+    int range = 99;         // --range=<r>: integer mode elements in [0, r]
+    gemm::Accumulator accumulator = gemm::Accumulator::Auto;   // --acc=auto|int32|int64
+    gemm::OverflowPolicy overflow = gemm::OverflowPolicy::Saturate;    // --overflow=saturate|detect
+    size_t cacheMiB = 0;    // --cache=<MiB>: reuse packed B and products by content, 0 = off
+    size_t operands = 4;    // --operands=<n>: distinct B operands in cache mode
+    double repeat = 0.25;   // --repeat=<p>: share of cache-mode products that repeat an earlier (A, B)
+};
+
+template <typename T>
+gemm::Options<T> gemmOptions(const BenchOptions& opts, const int numThreads, gemm::Op opB = gemm::Op::None);
+
+bool parseOptions(int argc, char* argv[], int first, BenchOptions& opts);
+
+template <typename T>
+struct InputMatrix {
+    T** rows = nullptr;
+    std::unique_ptr<MappedMatrix<T>> mapped;
+    bool owned = false;
+};
+
+template <typename T>
+InputMatrix<T> openInputMatrix(const std::string& path, const size_t NUM_ARR);
+
+template <typename T>
+void closeInputMatrix(InputMatrix<T>& M, const size_t NUM_ARR);
+
+template <typename MyType>
+void runTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runSparseTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+void checkBaselines(const BenchOptions& opts, const int numThreads, const std::string& type, const size_t NUM_ARR,
+                    const std::vector<std::pair<std::string, std::vector<double>>>& products);
+
+template <typename MyType>
+void runGemvTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runChainTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runEpilogueTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
 
 template <typename MyType>
-void runTest(const size_t NUM_ARR, const int numThreads, const int ROUND);
+void runStreamTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runScalingTest(size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts, ScalingKind kind);
+
+void runIntegerTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runSemiringTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runComplexTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runCacheTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runIncrementalTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
+
+template <typename MyType>
+void runMode(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts);
 
 int main(int argc, char* argv[]) {
-    if (argc < 4 || argc > 4) {
-        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round>\n";
+    BenchOptions opts;
+    if (argc < 4 || !parseOptions(argc, argv, 4, opts)) {
+        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round> [--a=<file>] [--b=<file>] [--c=<file>]\n";
+        std::cerr << "       [--mode=dense|sparse|gemv|chain|epilogue|stream|strong|weak|integer|semiring|complex|cache|incremental]\n";
+        std::cerr << "       [--density=<d>] [--block=<b>]\n";
+        std::cerr << "       [--calls=<n>] [--chain=<d0>x<d1>x...] [--alpha=<a>] [--beta=<b>] [--act=none|relu|gelu]\n";
+        std::cerr << "       [--kernel=naive|tuned|blocked|auto] [--backend=pthread|pool|async|coroutine] [--items=<n>] [--depth=<d>]\n";
+        std::cerr << "       [--layout=rowmajor|morton] [--tile=<t>] [--profile] [--trace=<file.json>]\n";
+        std::cerr << "       [--baseline=<file>] [--save-baseline=<file>] [--threshold=<pct>]\n";
+        std::cerr << "       [--range=<r>] [--acc=auto|int32|int64] [--overflow=saturate|detect]\n";
+        std::cerr << "       [--cache=<MiB>] [--operands=<n>] [--repeat=<p>]\n";
+        std::cerr << "  files: .bin (binary, mmap'd), .mtx (MatrixMarket), .csv\n";
         return 1;
     }
 
     std::string mtype = argv[1];
-    const size_t NUM_ARR = static_cast<size_t>(std::stoul(argv[2]));
     const int numThreads = 8;
-    const int round = std::stoi(argv[3]);
-
-    if (mtype == "int") {
-        runTest<int>(NUM_ARR, numThreads, round);
-    } else if (mtype == "2long") {
-        runTest<long long>(NUM_ARR, numThreads, round);
-    } else if (mtype == "float") {
-        runTest<float>(NUM_ARR, numThreads, round);
-    } else if (mtype == "double") {
-        runTest<double>(NUM_ARR, numThreads, round);
-    } else {
-        std::cerr << "Unsupported type: " << mtype << "\n";
+
+    try {
+        const size_t NUM_ARR = static_cast<size_t>(std::stoul(argv[2]));
+        const int round = std::stoi(argv[3]);
+        printBuildInfo(std::cout);
+
+        gemm::Context ctx(numThreads);
+        if (mtype == "int") {
+            runMode<int>(ctx, NUM_ARR, numThreads, round, opts);
+        } else if (mtype == "2long") {
+            runMode<long long>(ctx, NUM_ARR, numThreads, round, opts);
+        } else if (mtype == "float") {
+            runMode<float>(ctx, NUM_ARR, numThreads, round, opts);
+        } else if (mtype == "double") {
+            runMode<double>(ctx, NUM_ARR, numThreads, round, opts);
+        } else {
+            std::cerr << "Unsupported type: " << mtype << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
 
     return 0;
 }
 
+bool parseOptions(int argc, char* argv[], int first, BenchOptions& opts) {
+    // a malformed number makes std::stoul/std::stod throw; report it with the usage text
+    int i = first;
+    try {
+        for (; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--a=", 0) == 0) {
+                opts.loadA = arg.substr(4);
+            } else if (arg.rfind("--b=", 0) == 0) {
+                opts.loadB = arg.substr(4);
+            } else if (arg.rfind("--c=", 0) == 0) {
+                opts.saveC = arg.substr(4);
+            } else if (arg.rfind("--mode=", 0) == 0) {
+                opts.mode = arg.substr(7);
+            } else if (arg.rfind("--density=", 0) == 0) {
+                opts.density = std::stod(arg.substr(10));
+            } else if (arg.rfind("--block=", 0) == 0) {
+                opts.blockSize = std::stoul(arg.substr(8));
+            } else if (arg.rfind("--calls=", 0) == 0) {
+                opts.calls = std::stoi(arg.substr(8));
+            } else if (arg.rfind("--chain=", 0) == 0) {
+                size_t pos = 8;
+                while (pos <= arg.size()) {
+                    size_t next = arg.find('x', pos);
+                    if (next == std::string::npos) {
+                        next = arg.size();
+                    }
+                    opts.chain.push_back(std::stoul(arg.substr(pos, next - pos)));
+                    pos = next + 1;
+                }
+            } else if (arg.rfind("--layout=", 0) == 0) {
+                opts.layout = arg.substr(9);
+            } else if (arg.rfind("--tile=", 0) == 0) {
+                opts.tile = std::stoul(arg.substr(7));
+            } else if (arg.rfind("--baseline=", 0) == 0) {
+                opts.baseline = arg.substr(11);
+            } else if (arg.rfind("--save-baseline=", 0) == 0) {
+                opts.saveBaseline = arg.substr(16);
+            } else if (arg.rfind("--threshold=", 0) == 0) {
+                opts.threshold = std::stod(arg.substr(12));
+            } else if (arg == "--profile") {
+                opts.profile = true;
+            } else if (arg.rfind("--trace=", 0) == 0) {
+                opts.trace = arg.substr(8);
+                opts.profile = true;
+            } else if (arg.rfind("--items=", 0) == 0) {
+                opts.items = std::stoul(arg.substr(8));
+            } else if (arg.rfind("--depth=", 0) == 0) {
+                opts.depth = std::stoul(arg.substr(8));
+            } else if (arg.rfind("--alpha=", 0) == 0) {
+                opts.alpha = std::stod(arg.substr(8));
+            } else if (arg.rfind("--beta=", 0) == 0) {
+                opts.beta = std::stod(arg.substr(7));
+            } else if (arg.rfind("--kernel=", 0) == 0) {
+                if (!gemm::parseAlgorithm(arg.substr(9), opts.kernel)) {
+                    std::cerr << "Unknown kernel: " << arg.substr(9) << "\n";
+                    return false;
+                }
+            } else if (arg.rfind("--backend=", 0) == 0) {
+                if (!gemm::parseBackend(arg.substr(10), opts.backend)) {
+                    std::cerr << "Unknown backend: " << arg.substr(10) << "\n";
+                    return false;
+                }
+            } else if (arg.rfind("--cache=", 0) == 0) {
+                opts.cacheMiB = std::stoul(arg.substr(8));
+            } else if (arg.rfind("--operands=", 0) == 0) {
+                opts.operands = std::stoul(arg.substr(11));
+            } else if (arg.rfind("--repeat=", 0) == 0) {
+                opts.repeat = std::stod(arg.substr(9));
+            } else if (arg.rfind("--range=", 0) == 0) {
+                opts.range = std::stoi(arg.substr(8));
+            } else if (arg.rfind("--acc=", 0) == 0) {
+                if (!gemm::parseAccumulator(arg.substr(6), opts.accumulator)) {
+                    std::cerr << "Unknown accumulator: " << arg.substr(6) << "\n";
+                    return false;
+                }
+            } else if (arg.rfind("--overflow=", 0) == 0) {
+                if (!gemm::parseOverflowPolicy(arg.substr(11), opts.overflow)) {
+                    std::cerr << "Unknown overflow policy: " << arg.substr(11) << "\n";
+                    return false;
+                }
+            } else if (arg.rfind("--act=", 0) == 0) {
+                if (!parseActivation(arg.substr(6), opts.act)) {
+                    std::cerr << "Unknown activation: " << arg.substr(6) << "\n";
+                    return false;
+                }
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid value: " << argv[i] << "\n";
+        return false;
+    }
+    if (opts.mode != "dense" && opts.mode != "sparse" && opts.mode != "gemv" && opts.mode != "chain" &&
+        opts.mode != "epilogue" && opts.mode != "stream" && opts.mode != "strong" && opts.mode != "weak" &&
+        opts.mode != "integer" && opts.mode != "semiring" && opts.mode != "complex" &&
+        opts.mode != "cache" && opts.mode != "incremental") {
+        std::cerr << "Unknown mode: " << opts.mode << "\n";
+        return false;
+    }
+    if (opts.operands == 0 || opts.repeat < 0 || opts.repeat > 1) {
+        std::cerr << "Cache operands must be positive and repeat in [0, 1]\n";
+        return false;
+    }
+    if (opts.range < 0) {
+        std::cerr << "Integer range must not be negative\n";
+        return false;
+    }
+    if (opts.layout != "rowmajor" && opts.layout != "morton") {
+        std::cerr << "Unknown layout: " << opts.layout << "\n";
+        return false;
+    }
+    if (opts.tile == 0) {
+        std::cerr << "Tile size must be positive\n";
+        return false;
+    }
+    if (opts.items == 0 || opts.depth == 0) {
+        std::cerr << "Stream items and depth must be positive\n";
+        return false;
+    }
+    if (opts.density < 0 || opts.density > 1 || opts.blockSize == 0) {
+        std::cerr << "Density must be in [0, 1] and block size positive\n";
+        return false;
+    }
+    if (opts.calls <= 0 || (!opts.chain.empty() && opts.chain.size() < 3) ||
+        std::find(opts.chain.begin(), opts.chain.end(), size_t(0)) != opts.chain.end()) {
+        std::cerr << "GEMV calls must be positive and a chain needs at least two nonzero shapes\n";
+        return false;
+    }
+    return true;
+}
+
+template <typename MyType>
+void runMode(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    if (opts.mode == "sparse") {
+        runSparseTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "gemv") {
+        runGemvTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "chain") {
+        runChainTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "epilogue") {
+        runEpilogueTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "stream") {
+        runStreamTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "strong") {
+        runScalingTest<MyType>(NUM_ARR, numThreads, ROUND, opts, ScalingKind::Strong);
+    } else if (opts.mode == "weak") {
+        runScalingTest<MyType>(NUM_ARR, numThreads, ROUND, opts, ScalingKind::Weak);
+    } else if (opts.mode == "semiring") {
+        runSemiringTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "complex") {
+        runComplexTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "incremental") {
+        runIncrementalTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "cache") {
+        runCacheTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    } else if (opts.mode == "integer") {
+        if constexpr (std::is_same<MyType, int>::value) {
+            runIntegerTest(ctx, NUM_ARR, numThreads, ROUND, opts);
+        } else {
+            throw std::runtime_error("--mode=integer runs on type int");
+        }
+    } else {
+        runTest<MyType>(ctx, NUM_ARR, numThreads, ROUND, opts);
+    }
+}
+
+// Rows share one contiguous block so a matrix can be written or mapped as a single buffer
 template <typename T>
 T** allocateMatrix(size_t size) {
     T** matrix = new T*[size];
+    T* block = new T[size * size];
     for (size_t i = 0; i < size; i++) {
-        matrix[i] = new T[size];
+        matrix[i] = block + i * size;
     }
     return matrix;
 }
 
 template <typename T>
 void deallocateMatrix(T** matrix, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        delete[] matrix[i];
+    if (size > 0) {
+        delete[] matrix[0];
     }
     delete[] matrix;
 }
@@ -116,60 +419,58 @@ void RandomElements(T** Arr, const size_t NUM_ARR) {
     }
 }
 
+// Each element is nonzero with probability density; nonzeros are drawn from 1..99
 template <typename T>
-void Print_arr(T** Arr, const size_t NUM_ARR) {
+void RandomSparseElements(T** Arr, const size_t NUM_ARR, const double density) {
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    std::bernoulli_distribution keep(density);
+    std::uniform_int_distribution<int> dis(1, 99);
     for (size_t i = 0; i < NUM_ARR; i++) {
         for (size_t j = 0; j < NUM_ARR; j++) {
-            std::cout << Arr[i][j] << " ";
+            Arr[i][j] = keep(gen) ? static_cast<T>(dis(gen)) : T(0);
         }
-        std::cout << std::endl;
     }
 }
 
 template <typename T>
-void* RC_Product(void* arg) {
-    auto* data = static_cast<ThreadData<T>*>(arg);
-
-    for (size_t i = data->startRow; i < data->endRow; i++) {
-        for (size_t j = 0; j < data->NUM_ARR; j++) {
-            T sum = 0;
-            for (size_t k = 0; k < data->NUM_ARR; k++) {
-                sum += data->A[i][k] * data->B[k][j];
-            }
-            data->C[i][j] = sum;
+void Print_arr(T** Arr, const size_t NUM_ARR) {
+    for (size_t i = 0; i < NUM_ARR; i++) {
+        for (size_t j = 0; j < NUM_ARR; j++) {
+            std::cout << Arr[i][j] << " ";
         }
+        std::cout << '\n';
     }
-    return nullptr;
+    std::cout.flush();
 }
 
+// Unfused epilogue: a second pass over C that reads the plain product from A (used here as
+// the scratch result) and folds in beta * C, the bias and the activation
 template <typename T>
-void* RR_Product(void* arg) {
+void* Epilogue_Pass(void* arg) {
     auto* data = static_cast<ThreadData<T>*>(arg);
 
     for (size_t i = data->startRow; i < data->endRow; i++) {
         for (size_t j = 0; j < data->NUM_ARR; j++) {
-            T sum = 0;
-            for (size_t k = 0; k < data->NUM_ARR; k++) {
-                sum += data->A[i][k] * data->B[j][k];
-            }
-            data->C[i][j] = sum;
+            data->C[i][j] = applyEpilogue(*data->ep, data->A[i][j], data->C[i][j], j);
         }
     }
     return nullptr;
 }
 
-template <typename Func, typename T>
-double measureExecutionTime(Func func, T** A, T** B, T** C, const size_t NUM_ARR, const int numThreads) {
+// Split NUM_ROWS evenly over the threads (the last one takes the remainder) and time one run
+template <typename Data>
+double measureThreads(void* (*func)(void*), Data* threadData, const size_t NUM_ROWS, const int numThreads) {
     pthread_t threads[numThreads];
-    ThreadData<T> threadData[numThreads];
-    size_t rowsPerThread = NUM_ARR / numThreads;
+    size_t rowsPerThread = NUM_ROWS / numThreads;
 
     auto start_time = std::chrono::high_resolution_clock::now();
     for (int t = 0; t < numThreads; t++) {
         size_t startRow = t * rowsPerThread;
-        size_t endRow = (t == numThreads - 1) ? NUM_ARR : (startRow + rowsPerThread);
+        size_t endRow = (t == numThreads - 1) ? NUM_ROWS : (startRow + rowsPerThread);
 
-        threadData[t] = {A, B, C, startRow, endRow, NUM_ARR};
+        threadData[t].startRow = startRow;
+        threadData[t].endRow = endRow;
         pthread_create(&threads[t], nullptr, func, &threadData[t]);
     }
 
@@ -182,6 +483,87 @@ double measureExecutionTime(Func func, T** A, T** B, T** C, const size_t NUM_ARR
     return duration.count();
 }
 
+// One C = A * B (options.opB = Trans: the RR product) through the gemm library
+template <typename T>
+double measureExecutionTime(gemm::Context& ctx, T** A, T** B, T** C, const size_t NUM_ARR,
+                            const gemm::Options<T>& options) {
+    if (options.profile) {
+        options.profile->clear();
+    }
+    auto start_time = std::chrono::high_resolution_clock::now();
+    gemm::gemm<T>(ctx, gemm::view(A, NUM_ARR, NUM_ARR), gemm::view(B, NUM_ARR, NUM_ARR), gemm::view(C, NUM_ARR, NUM_ARR),
+                  options);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    return duration.count();
+}
+
+// --baseline: compare each product's round times with the last stored run for this machine,
+// configuration, type and size, and throw once all are printed if any slowed down
+// significantly by more than --threshold percent. --save-baseline: append them afterwards.
+void checkBaselines(const BenchOptions& opts, const int numThreads, const std::string& type, const size_t NUM_ARR,
+                    const std::vector<std::pair<std::string, std::vector<double>>>& products) {
+    if (opts.baseline.empty() && opts.saveBaseline.empty()) {
+        return;
+    }
+    const std::string fingerprint = machineFingerprint();
+    std::string config = "dense kernel=" + std::string(gemm::algorithmName(opts.kernel)) +
+                         " backend=" + gemm::backendName(opts.backend) + " threads=" + std::to_string(numThreads);
+    if (opts.layout == "morton") {
+        config += " tile=" + std::to_string(opts.tile);
+    }
+    // a cache turns repeated products into copy-outs, and loaded inputs repeat where random ones do not
+    if (opts.cacheMiB > 0) {
+        config += " cache=" + std::to_string(opts.cacheMiB);
+    }
+    config += std::string(" a=") + (opts.loadA.empty() ? "random" : "file") + " b=" + (opts.loadB.empty() ? "random" : "file");
+
+    std::vector<std::string> regressions;
+    if (!opts.baseline.empty()) {
+        std::map<BaselineKey, std::vector<double>> store = loadBaselines(opts.baseline);
+        for (const auto& product : products) {
+            auto it = store.find({fingerprint, config, type, NUM_ARR, product.first});
+            if (it == store.end()) {
+                std::cout << "Baseline " << product.first << " product: none stored" << std::endl;
+                continue;
+            }
+            BaselineComparison result = compareToBaseline(it->second, product.second, opts.threshold / 100);
+            printBaselineComparison(std::cout, product.first + " product", result);
+            if (result.verdict == BaselineVerdict::Regression) {
+                regressions.push_back(product.first);
+            }
+        }
+    }
+
+    if (!opts.saveBaseline.empty()) {
+        for (const auto& product : products) {
+            appendBaseline(opts.saveBaseline, {fingerprint, config, type, NUM_ARR, product.first}, product.second);
+        }
+        std::cout << "Saved baseline to " << opts.saveBaseline << std::endl;
+    }
+
+    if (!regressions.empty()) {
+        std::ostringstream message;
+        message << "performance regression beyond " << opts.threshold << "% in";
+        for (size_t i = 0; i < regressions.size(); i++) {
+            message << (i ? ", " : " ") << regressions[i];
+        }
+        message << " against " << opts.baseline;
+        throw std::runtime_error(message.str());
+    }
+}
+
+// The driver's --kernel/--backend choice, run on numThreads threads
+template <typename T>
+gemm::Options<T> gemmOptions(const BenchOptions& opts, const int numThreads, gemm::Op opB) {
+    gemm::Options<T> options;
+    options.opB = opB;
+    options.algorithm = opts.kernel;
+    options.backend = opts.backend;
+    options.threads = numThreads;
+    return options;
+}
+
 void printTimeResult(const double* RC_Time, const double* RR_Time, const int ROUND) {
     double RC_avg_time = 0, RR_avg_time = 0;
     for (int i = 0; i < ROUND; i++) {
@@ -207,39 +589,1215 @@ std::string demangleTypeName() {
     return result;
 }
 
+// Binary files are mapped in place; text files are parsed into a freshly allocated matrix
+template <typename T>
+InputMatrix<T> openInputMatrix(const std::string& path, const size_t NUM_ARR) {
+    InputMatrix<T> M;
+    if (path.empty()) {
+        M.rows = allocateMatrix<T>(NUM_ARR);
+        M.owned = true;
+    } else if (matrixFormatFromPath(path) == MatrixFormat::Binary) {
+        M.mapped = std::make_unique<MappedMatrix<T>>(path);
+        if (M.mapped->numRows != NUM_ARR || M.mapped->numCols != NUM_ARR) {
+            throw std::runtime_error(path + ": expected " + std::to_string(NUM_ARR) + "x" + std::to_string(NUM_ARR));
+        }
+        M.rows = M.mapped->rows();
+    } else {
+        M.rows = allocateMatrix<T>(NUM_ARR);
+        M.owned = true;
+        loadMatrix(path, M.rows, NUM_ARR, NUM_ARR);
+    }
+    return M;
+}
+
+template <typename T>
+void closeInputMatrix(InputMatrix<T>& M, const size_t NUM_ARR) {
+    if (M.owned) {
+        deallocateMatrix(M.rows, NUM_ARR);
+    }
+    M.mapped.reset();
+    M.rows = nullptr;
+}
+
 template <typename MyType>
-void runTest(const size_t NUM_ARR, const int numThreads, const int ROUND) {
-    MyType** A = allocateMatrix<MyType>(NUM_ARR);
-    MyType** B = allocateMatrix<MyType>(NUM_ARR);
+void runTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    for (const std::string& path : {opts.loadA, opts.loadB}) {
+        if (path.empty()) {
+            continue;
+        }
+        MatrixFileInfo info = probeMatrixFile(path);
+        if (info.rows != info.cols) {
+            throw std::runtime_error(path + ": matrix must be square");
+        }
+        if (info.rows != NUM_ARR) {
+            std::cout << "Using size " << info.rows << " from " << path << std::endl;
+            NUM_ARR = info.rows;
+        }
+    }
+
+    InputMatrix<MyType> inA = openInputMatrix<MyType>(opts.loadA, NUM_ARR);
+    InputMatrix<MyType> inB = openInputMatrix<MyType>(opts.loadB, NUM_ARR);
+    MyType** A = inA.rows;
+    MyType** B = inB.rows;
     MyType** C_RC = allocateMatrix<MyType>(NUM_ARR);
     MyType** C_RR = allocateMatrix<MyType>(NUM_ARR);
 
-    double RC_Time[ROUND], RR_Time[ROUND];
+    double RC_Time[ROUND], RR_Time[ROUND], Morton_Time[ROUND], Convert_Time[ROUND];
     bool swap_flag = false;
+    const bool morton = opts.layout == "morton";
+    MortonMatrix<MyType> A_Morton, B_Morton, C_Morton;
+    MyType** C_FromMorton = morton ? allocateMatrix<MyType>(NUM_ARR) : nullptr;
+    double mortonDiff = 0;
+    gemm::Options<MyType> rcProduct = gemmOptions<MyType>(opts, numThreads);
+    gemm::Options<MyType> rrProduct = gemmOptions<MyType>(opts, numThreads, gemm::Op::Trans);
+    // Each measurement clears its profile, so after the loop they hold the last round
+    ThreadProfile rcProfile(numThreads), rrProfile(numThreads);
+    if (opts.profile) {
+        rcProduct.profile = &rcProfile;
+        rrProduct.profile = &rrProfile;
+    }
+    // Random operands change every round, so results only repeat with --a and --b
+    std::unique_ptr<gemm::ProductCache> cache;
+    if (opts.cacheMiB > 0) {
+        cache = std::make_unique<gemm::ProductCache>(opts.cacheMiB << 20);
+        rcProduct.cache = cache.get();
+        rrProduct.cache = cache.get();
+    }
 
-    std::cout << "TESTING {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>() << "}" << std::endl;
+    std::cout << "TESTING {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>()
+              << ", kernel:" << gemm::algorithmName(opts.kernel) << ", backend:" << gemm::backendName(opts.backend)
+              << "}" << std::endl;
 
     for (int i = 0; i < ROUND; i++) {
-        RandomElements(A, NUM_ARR);
-        RandomElements(B, NUM_ARR);
+        if (opts.loadA.empty()) {
+            RandomElements(A, NUM_ARR);
+        }
+        if (opts.loadB.empty()) {
+            RandomElements(B, NUM_ARR);
+        }
 
         if (swap_flag) {
-            RC_Time[i] = measureExecutionTime(RC_Product<MyType>, A, B, C_RC, NUM_ARR, numThreads);
-            RR_Time[i] = measureExecutionTime(RR_Product<MyType>, A, B, C_RR, NUM_ARR, numThreads);
+            RC_Time[i] = measureExecutionTime(ctx, A, B, C_RC, NUM_ARR, rcProduct);
+            RR_Time[i] = measureExecutionTime(ctx, A, B, C_RR, NUM_ARR, rrProduct);
         } else {
-            RR_Time[i] = measureExecutionTime(RR_Product<MyType>, A, B, C_RR, NUM_ARR, numThreads);
-            RC_Time[i] = measureExecutionTime(RC_Product<MyType>, A, B, C_RC, NUM_ARR, numThreads);
+            RR_Time[i] = measureExecutionTime(ctx, A, B, C_RR, NUM_ARR, rrProduct);
+            RC_Time[i] = measureExecutionTime(ctx, A, B, C_RC, NUM_ARR, rcProduct);
         }
         std::cout << "Round " << i + 1 << ":" << std::endl;
         std::cout << "Execution Time RC product: " << RC_Time[i] << " seconds" << std::endl;
         std::cout << "Execution Time RR product: " << RR_Time[i] << " seconds" << std::endl;
         swap_flag = !swap_flag;
+
+        if (morton) {
+            // layout conversion is reported next to the product, not inside it
+            auto convert_start = std::chrono::high_resolution_clock::now();
+            packMorton(A, NUM_ARR, opts.tile, A_Morton);
+            packMorton(B, NUM_ARR, opts.tile, B_Morton);
+            auto product_start = std::chrono::high_resolution_clock::now();
+            mortonMultiply(ctx, A_Morton, B_Morton, C_Morton, numThreads);
+            auto product_end = std::chrono::high_resolution_clock::now();
+            unpackMorton(C_Morton, C_FromMorton);
+            auto convert_end = std::chrono::high_resolution_clock::now();
+            Morton_Time[i] = std::chrono::duration<double>(product_end - product_start).count();
+            Convert_Time[i] = std::chrono::duration<double>((product_start - convert_start) + (convert_end - product_end)).count();
+
+            for (size_t r = 0; r < NUM_ARR; r++) {
+                for (size_t c = 0; c < NUM_ARR; c++) {
+                    double diff = std::abs(static_cast<double>(C_FromMorton[r][c]) - static_cast<double>(C_RC[r][c]));
+                    mortonDiff = std::max(mortonDiff, diff / std::max(1.0, std::abs(static_cast<double>(C_RC[r][c]))));
+                }
+            }
+            std::cout << "Execution Time Morton product: " << Morton_Time[i] << " seconds (layout conversion "
+                      << Convert_Time[i] << " seconds)" << std::endl;
+        }
     }
 
     printTimeResult(RC_Time, RR_Time, ROUND);
+    if (cache) {
+        gemm::printCacheReport(std::cout, *cache);
+    }
+    if (opts.profile) {
+        std::cout << "RC product, last round:" << std::endl;
+        rcProfile.printReport(std::cout);
+        std::cout << "RR product, last round:" << std::endl;
+        rrProfile.printReport(std::cout);
+    }
+    if (!opts.trace.empty()) {
+        writeChromeTrace(opts.trace, {{"RC product", &rcProfile}, {"RR product", &rrProfile}});
+        std::cout << "Saved thread trace to " << opts.trace << std::endl;
+    }
+    if (morton) {
+        double mortonAvg = 0, convertAvg = 0, rcAvg = 0;
+        for (int i = 0; i < ROUND; i++) {
+            mortonAvg += Morton_Time[i] / ROUND;
+            convertAvg += Convert_Time[i] / ROUND;
+            rcAvg += RC_Time[i] / ROUND;
+        }
+        std::cout << "Average Execution Time for Morton product: " << mortonAvg << " seconds (tile " << A_Morton.tile
+                  << ", layout conversion " << convertAvg << " seconds)" << std::endl;
+        std::cout << "Morton speedup over RC: " << rcAvg / mortonAvg << std::endl;
+        std::cout << "Max relative difference: " << mortonDiff << std::endl;
+        deallocateMatrix(C_FromMorton, NUM_ARR);
+    }
 
-    deallocateMatrix(A, NUM_ARR);
-    deallocateMatrix(B, NUM_ARR);
+    if (!opts.saveC.empty()) {
+        saveMatrix(opts.saveC, C_RC, NUM_ARR, NUM_ARR);
+        std::cout << "Saved RC result to " << opts.saveC << std::endl;
+    }
+
+    closeInputMatrix(inA, NUM_ARR);
+    closeInputMatrix(inB, NUM_ARR);
     deallocateMatrix(C_RC, NUM_ARR);
     deallocateMatrix(C_RR, NUM_ARR);
-}
\ No newline at end of file
+
+    std::vector<std::pair<std::string, std::vector<double>>> products = {
+        {"RC", std::vector<double>(RC_Time, RC_Time + ROUND)}, {"RR", std::vector<double>(RR_Time, RR_Time + ROUND)}};
+    if (morton) {
+        products.push_back({"Morton", std::vector<double>(Morton_Time, Morton_Time + ROUND)});
+    }
+    checkBaselines(opts, numThreads, demangleTypeName<MyType>(), NUM_ARR, products);
+}
+
+// Density sweep: dense RC against CSR/BSR SpMM (sparse A, dense B) and CSR SpGEMM
+// (sparse A and B). Conversion to the sparse formats is reported but not timed as part
+// of the products. With --a/--b the loaded matrices are used at their own density; an
+// operand not loaded is random at --density, or else at the loaded one's density.
+template <typename MyType>
+void runSparseTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    bool fromFiles = !opts.loadA.empty() || !opts.loadB.empty();
+    for (const std::string& path : {opts.loadA, opts.loadB}) {
+        if (!path.empty()) {
+            MatrixFileInfo info = probeMatrixFile(path);
+            if (info.rows != info.cols) {
+                throw std::runtime_error(path + ": matrix must be square");
+            }
+            NUM_ARR = info.rows;
+        }
+    }
+
+    std::vector<double> densities;
+    if (fromFiles) {
+        densities = {-1};
+    } else if (opts.density > 0) {
+        densities = {opts.density};
+    } else {
+        densities = {0.5, 0.2, 0.1, 0.05, 0.02, 0.01, 0.005};
+    }
+
+    InputMatrix<MyType> inA = openInputMatrix<MyType>(opts.loadA, NUM_ARR);
+    InputMatrix<MyType> inB = openInputMatrix<MyType>(opts.loadB, NUM_ARR);
+    MyType** A = inA.rows;
+    MyType** B = inB.rows;
+    MyType** C_Dense = allocateMatrix<MyType>(NUM_ARR);
+    MyType** C_Sparse = allocateMatrix<MyType>(NUM_ARR);
+    const size_t bs = opts.blockSize;
+    double fillDensity = opts.density;
+    if (fromFiles && fillDensity == 0) {
+        MyType** loaded = opts.loadA.empty() ? B : A;
+        size_t nonzeros = 0;
+        for (size_t i = 0; i < NUM_ARR; i++) {
+            nonzeros += NUM_ARR - std::count(loaded[i], loaded[i] + NUM_ARR, MyType(0));
+        }
+        fillDensity = static_cast<double>(nonzeros) / (static_cast<double>(NUM_ARR) * NUM_ARR);
+    }
+
+    std::cout << "TESTING SPARSE {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>()
+              << ", block:" << bs << "}" << std::endl;
+    std::cout << std::setw(9) << "density" << std::setw(12) << "nnz(A)" << std::setw(12) << "convert"
+              << std::setw(12) << "dense" << std::setw(12) << "CSR" << std::setw(12) << "BSR"
+              << std::setw(12) << "SpGEMM" << std::setw(10) << "CSR x" << std::setw(12) << "max diff" << std::endl;
+
+    for (double density : densities) {
+        double convertTime = 0, denseTime = 0, csrTime = 0, bsrTime = 0, spgemmTime = 0, maxDiff = 0;
+        size_t nnz = 0;
+
+        for (int r = 0; r < ROUND; r++) {
+            if (opts.loadA.empty()) {
+                RandomSparseElements(A, NUM_ARR, density >= 0 ? density : fillDensity);
+            }
+            if (opts.loadB.empty()) {
+                RandomSparseElements(B, NUM_ARR, density >= 0 ? density : fillDensity);
+            }
+
+            auto convert_start = std::chrono::high_resolution_clock::now();
+            CSRMatrix<MyType> A_csr = toCSR(A, NUM_ARR, NUM_ARR);
+            BSRMatrix<MyType> A_bsr = toBSR(A, NUM_ARR, NUM_ARR, bs);
+            CSRMatrix<MyType> B_csr = toCSR(B, NUM_ARR, NUM_ARR);
+            std::chrono::duration<double> convert = std::chrono::high_resolution_clock::now() - convert_start;
+            convertTime += convert.count();
+            nnz = A_csr.nnz();
+
+            std::vector<CSRPart<MyType>> parts(numThreads);
+            std::vector<SparseThreadData<MyType>> threadData(numThreads);
+            for (int t = 0; t < numThreads; t++) {
+                threadData[t] = {&A_csr, &A_bsr, &B_csr, B, C_Sparse, &parts[t], 0, 0, NUM_ARR};
+            }
+
+            // Every sparse kernel writes C_Sparse and is checked before the next overwrites it;
+            // clearing it first keeps an earlier kernel's result from hiding rows one skipped
+            auto checkAgainstDense = [&]() {
+                for (size_t i = 0; i < NUM_ARR; i++) {
+                    for (size_t j = 0; j < NUM_ARR; j++) {
+                        double diff = std::abs(static_cast<double>(C_Dense[i][j]) - static_cast<double>(C_Sparse[i][j]));
+                        maxDiff = std::max(maxDiff, diff);
+                    }
+                }
+            };
+            auto clearSparse = [&]() {
+                for (size_t i = 0; i < NUM_ARR; i++) {
+                    std::fill(C_Sparse[i], C_Sparse[i] + NUM_ARR, MyType(0));
+                }
+            };
+
+            denseTime += measureExecutionTime(ctx, A, B, C_Dense, NUM_ARR, gemmOptions<MyType>(opts, numThreads));
+            clearSparse();
+            bsrTime += measureThreads(BSR_SpMM<MyType>, threadData.data(), A_bsr.blockRows, numThreads);
+            checkAgainstDense();
+            clearSparse();
+            csrTime += measureThreads(CSR_SpMM<MyType>, threadData.data(), NUM_ARR, numThreads);
+            checkAgainstDense();
+
+            auto spgemm_start = std::chrono::high_resolution_clock::now();
+            measureThreads(CSR_SpGEMM<MyType>, threadData.data(), NUM_ARR, numThreads);
+            CSRMatrix<MyType> C_csr = assembleCSR(parts, NUM_ARR, NUM_ARR);
+            std::chrono::duration<double> spgemm = std::chrono::high_resolution_clock::now() - spgemm_start;
+            spgemmTime += spgemm.count();
+
+            for (size_t i = 0; i < NUM_ARR; i++) {
+                std::fill(C_Sparse[i], C_Sparse[i] + NUM_ARR, MyType(0));
+                for (size_t p = C_csr.rowPtr[i]; p < C_csr.rowPtr[i + 1]; p++) {
+                    C_Sparse[i][C_csr.colIdx[p]] = C_csr.values[p];
+                }
+            }
+            checkAgainstDense();
+        }
+
+        double shown = (density >= 0) ? density : static_cast<double>(nnz) / (static_cast<double>(NUM_ARR) * NUM_ARR);
+        std::cout << std::setw(9) << shown << std::setw(12) << nnz << std::setw(12) << convertTime / ROUND
+                  << std::setw(12) << denseTime / ROUND << std::setw(12) << csrTime / ROUND
+                  << std::setw(12) << bsrTime / ROUND << std::setw(12) << spgemmTime / ROUND
+                  << std::setw(10) << denseTime / csrTime << std::setw(12) << maxDiff << std::endl;
+    }
+
+    closeInputMatrix(inA, NUM_ARR);
+    closeInputMatrix(inB, NUM_ARR);
+    deallocateMatrix(C_Dense, NUM_ARR);
+    deallocateMatrix(C_Sparse, NUM_ARR);
+}
+
+// Repeated y = A * x calls. Reports the time per call and the bandwidth of streaming A,
+// which is what bounds GEMV; the first call of each round is checked against a serial loop.
+// Rows are split on the context's persistent pool, so no thread start-up is timed.
+template <typename MyType>
+void runGemvTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    if (!opts.loadA.empty()) {
+        NUM_ARR = probeMatrixFile(opts.loadA).rows;
+    }
+    InputMatrix<MyType> inA = openInputMatrix<MyType>(opts.loadA, NUM_ARR);
+    MyType** A = inA.rows;
+    MyType** X = allocateMatrix<MyType>(NUM_ARR);    // one input vector per row, cycled through
+    std::vector<MyType> y(NUM_ARR), ref(NUM_ARR);
+    double GEMV_Time[ROUND];
+    double maxDiff = 0;
+
+    std::cout << "TESTING GEMV {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>()
+              << ", calls:" << opts.calls << "}" << std::endl;
+
+    for (int r = 0; r < ROUND; r++) {
+        if (opts.loadA.empty()) {
+            RandomElements(A, NUM_ARR);
+        }
+        RandomElements(X, NUM_ARR);
+
+        GEMV_Time[r] = 0;
+        for (int call = 0; call < opts.calls; call++) {
+            const MyType* x = X[call % NUM_ARR];
+            auto start_time = std::chrono::high_resolution_clock::now();
+            gemm::parallelRows(ctx, gemm::Backend::Pool, numThreads, NUM_ARR, [&](size_t begin, size_t end) {
+                GemvThreadData<MyType> part = {A, x, y.data(), begin, end, NUM_ARR};
+                GEMV_Product<MyType>(&part);
+            });
+            std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start_time;
+            GEMV_Time[r] += duration.count();
+
+            if (call == 0) {
+                for (size_t i = 0; i < NUM_ARR; i++) {
+                    ref[i] = 0;
+                    for (size_t j = 0; j < NUM_ARR; j++) {
+                        ref[i] += A[i][j] * X[0][j];
+                    }
+                    double diff = std::abs(static_cast<double>(ref[i]) - static_cast<double>(y[i]));
+                    maxDiff = std::max(maxDiff, diff / std::max(1.0, std::abs(static_cast<double>(ref[i]))));
+                }
+            }
+        }
+        GEMV_Time[r] /= opts.calls;
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        std::cout << "Execution Time GEMV: " << GEMV_Time[r] << " seconds per call" << std::endl;
+    }
+
+    double avg = 0;
+    for (int r = 0; r < ROUND; r++) {
+        avg += GEMV_Time[r];
+    }
+    avg /= ROUND;
+    double bytes = static_cast<double>(NUM_ARR) * NUM_ARR * sizeof(MyType);
+    std::cout << "Summary: " << std::endl;
+    std::cout << "Average Execution Time for GEMV: " << avg << " seconds per call" << std::endl;
+    std::cout << "Bandwidth: " << bytes / avg / 1e9 << " GB/s" << std::endl;
+    std::cout << "Throughput: " << 2.0 * NUM_ARR * NUM_ARR / avg / 1e9 << " GFLOP/s" << std::endl;
+    std::cout << "Max relative difference: " << maxDiff << std::endl;
+
+    closeInputMatrix(inA, NUM_ARR);
+    deallocateMatrix(X, NUM_ARR);
+}
+
+// Matrix chain A1 * A2 * ... * An: the dynamic-programming order against plain left to
+// right. Intermediates come from a pool that lives across rounds, so only the first round
+// allocates. Without --chain the shapes default to N x N/8 x N x N/8 x N.
+template <typename MyType>
+void runChainTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    std::vector<size_t> dims = opts.chain;
+    if (dims.empty()) {
+        size_t narrow = std::max<size_t>(1, NUM_ARR / 8);
+        dims = {NUM_ARR, narrow, NUM_ARR, narrow, NUM_ARR};
+    }
+    const size_t n = dims.size() - 1;
+    ChainPlan best = planMatrixChain(dims);
+    ChainPlan naive = leftToRightChain(dims);
+    MatrixPool<MyType> pool;
+
+    std::vector<std::vector<MyType>> storage(n);
+    std::vector<MyType*> mats(n);
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    std::uniform_int_distribution<int> dis(-1, 1);    // keeps integer chains from overflowing
+
+    // Intermediates have arbitrary shapes, so the library picks the algorithm per product
+    gemm::Options<MyType> options = gemmOptions<MyType>(opts, numThreads);
+    options.algorithm = gemm::Algorithm::Auto;
+    auto multiply = [&ctx, &options](const MyType* A, const MyType* B, MyType* C, size_t M, size_t K, size_t N) {
+        gemm::gemm<MyType>(ctx, gemm::view(A, M, K), gemm::view(B, K, N), gemm::view(C, M, N), options);
+    };
+
+    std::cout << "TESTING CHAIN {shapes:";
+    for (size_t i = 0; i < dims.size(); i++) {
+        std::cout << (i ? "x" : "") << dims[i];
+    }
+    std::cout << ", type:" << demangleTypeName<MyType>() << "}" << std::endl;
+    std::cout << "Optimal order: " << chainParenthesization(best, 1, n) << " (" << best.flops / 1e9 << " GFLOP)" << std::endl;
+    std::cout << "Left to right: " << chainParenthesization(naive, 1, n) << " (" << naive.flops / 1e9 << " GFLOP)" << std::endl;
+
+    double Best_Time[ROUND], Naive_Time[ROUND];
+    double maxDiff = 0;
+    for (int r = 0; r < ROUND; r++) {
+        for (size_t i = 0; i < n; i++) {
+            storage[i].resize(dims[i] * dims[i + 1]);
+            for (MyType& v : storage[i]) {
+                v = static_cast<MyType>(dis(gen));
+            }
+            mats[i] = storage[i].data();
+        }
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        MyType* C_Best = executeChain(best, mats, pool, multiply);
+        auto mid_time = std::chrono::high_resolution_clock::now();
+        MyType* C_Naive = executeChain(naive, mats, pool, multiply);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        Best_Time[r] = std::chrono::duration<double>(mid_time - start_time).count();
+        Naive_Time[r] = std::chrono::duration<double>(end_time - mid_time).count();
+
+        for (size_t i = 0; i < dims[0] * dims[n]; i++) {
+            double diff = std::abs(static_cast<double>(C_Best[i]) - static_cast<double>(C_Naive[i]));
+            maxDiff = std::max(maxDiff, diff / std::max(1.0, std::abs(static_cast<double>(C_Naive[i]))));
+        }
+        pool.release(C_Best);
+        pool.release(C_Naive);
+
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        std::cout << "Execution Time optimal chain: " << Best_Time[r] << " seconds" << std::endl;
+        std::cout << "Execution Time left-to-right chain: " << Naive_Time[r] << " seconds" << std::endl;
+    }
+
+    double bestAvg = 0, naiveAvg = 0;
+    for (int r = 0; r < ROUND; r++) {
+        bestAvg += Best_Time[r];
+        naiveAvg += Naive_Time[r];
+    }
+    bestAvg /= ROUND;
+    naiveAvg /= ROUND;
+    std::cout << "Summary: " << std::endl;
+    std::cout << "Average Execution Time for optimal chain: " << bestAvg << " seconds ("
+              << best.flops / bestAvg / 1e9 << " GFLOP/s)" << std::endl;
+    std::cout << "Average Execution Time for left-to-right chain: " << naiveAvg << " seconds ("
+              << naive.flops / naiveAvg / 1e9 << " GFLOP/s)" << std::endl;
+    std::cout << "Speedup: " << naiveAvg / bestAvg << std::endl;
+    std::cout << "Pool buffers allocated: " << pool.allocations << ", reused: " << pool.reuses << std::endl;
+    std::cout << "Max relative difference: " << maxDiff << std::endl;
+}
+
+// C = act(alpha * A * B + beta * C + bias) computed in the RC kernel's epilogue against the
+// same result built as a plain RC product followed by a separate pass over C
+template <typename MyType>
+void runEpilogueTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    MyType** A = allocateMatrix<MyType>(NUM_ARR);
+    MyType** B = allocateMatrix<MyType>(NUM_ARR);
+    MyType** C_Fused = allocateMatrix<MyType>(NUM_ARR);
+    MyType** C_Unfused = allocateMatrix<MyType>(NUM_ARR);
+    MyType** Product = allocateMatrix<MyType>(NUM_ARR);
+    std::vector<MyType> bias(NUM_ARR);
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    std::uniform_int_distribution<int> dis(0, 99);
+
+    Epilogue<MyType> ep;
+    ep.alpha = static_cast<MyType>(opts.alpha);
+    ep.beta = static_cast<MyType>(opts.beta);
+    ep.bias = bias.data();
+    ep.act = opts.act;
+    const gemm::Options<MyType> plain = gemmOptions<MyType>(opts, numThreads);
+    gemm::Options<MyType> fused = plain;
+    fused.ep = &ep;
+
+    double Fused_Time[ROUND], Unfused_Time[ROUND];
+    double maxDiff = 0;
+
+    std::cout << "TESTING EPILOGUE {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>()
+              << ", alpha:" << opts.alpha << ", beta:" << opts.beta << "}" << std::endl;
+
+    for (int r = 0; r < ROUND; r++) {
+        RandomElements(A, NUM_ARR);
+        RandomElements(B, NUM_ARR);
+        RandomElements(C_Fused, NUM_ARR);
+        for (size_t j = 0; j < NUM_ARR; j++) {
+            // around minus the typical alpha * A * B value, so the activation actually clips
+            bias[j] = -static_cast<MyType>(dis(gen) * 50.0 * NUM_ARR * opts.alpha);
+        }
+        for (size_t i = 0; i < NUM_ARR; i++) {
+            for (size_t j = 0; j < NUM_ARR; j++) {
+                C_Unfused[i][j] = C_Fused[i][j];
+            }
+        }
+
+        Fused_Time[r] = measureExecutionTime(ctx, A, B, C_Fused, NUM_ARR, fused);
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+        measureExecutionTime(ctx, A, B, Product, NUM_ARR, plain);
+        std::vector<ThreadData<MyType>> threadData(numThreads, {Product, B, C_Unfused, 0, 0, NUM_ARR, &ep});
+        measureThreads(Epilogue_Pass<MyType>, threadData.data(), NUM_ARR, numThreads);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        Unfused_Time[r] = std::chrono::duration<double>(end_time - start_time).count();
+
+        for (size_t i = 0; i < NUM_ARR; i++) {
+            for (size_t j = 0; j < NUM_ARR; j++) {
+                double diff = std::abs(static_cast<double>(C_Fused[i][j]) - static_cast<double>(C_Unfused[i][j]));
+                maxDiff = std::max(maxDiff, diff / std::max(1.0, std::abs(static_cast<double>(C_Unfused[i][j]))));
+            }
+        }
+
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        std::cout << "Execution Time fused epilogue: " << Fused_Time[r] << " seconds" << std::endl;
+        std::cout << "Execution Time unfused epilogue: " << Unfused_Time[r] << " seconds" << std::endl;
+    }
+
+    double fusedAvg = 0, unfusedAvg = 0;
+    for (int r = 0; r < ROUND; r++) {
+        fusedAvg += Fused_Time[r];
+        unfusedAvg += Unfused_Time[r];
+    }
+    fusedAvg /= ROUND;
+    unfusedAvg /= ROUND;
+    std::cout << "Summary: " << std::endl;
+    std::cout << "Average Execution Time for fused epilogue: " << fusedAvg << " seconds" << std::endl;
+    std::cout << "Average Execution Time for unfused epilogue: " << unfusedAvg << " seconds" << std::endl;
+    std::cout << "Speedup: " << unfusedAvg / fusedAvg << std::endl;
+    std::cout << "Max relative difference: " << maxDiff << std::endl;
+
+    deallocateMatrix(A, NUM_ARR);
+    deallocateMatrix(B, NUM_ARR);
+    deallocateMatrix(C_Fused, NUM_ARR);
+    deallocateMatrix(C_Unfused, NUM_ARR);
+    deallocateMatrix(Product, NUM_ARR);
+}
+
+// One (A, B) pair in flight through the stream, with room for its product
+template <typename T>
+struct StreamSlot {
+    T** A;
+    T** B;
+    T** C;
+    double checksum = 0;
+};
+
+// "C.bin" -> "C_7.bin": one output file per stream item
+inline std::string streamItemPath(const std::string& path, const size_t n) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return path.substr(0, dot) + "_" + std::to_string(n) + path.substr(dot);
+}
+
+inline void printStreamReport(const char* name, const PipelineReport& report) {
+    std::cout << name << ": " << report.throughput() << " products/s, latency p50 " << report.percentile(50)
+              << " p95 " << report.percentile(95) << " p99 " << report.percentile(99) << " seconds" << std::endl;
+}
+
+// A stream of products: loading or generating pair n + 1, multiplying pair n and writing out
+// pair n - 1 overlap as pipeline stages joined by queues of --depth entries. Compared with
+// the same three steps run one after another; reports products/s and per-item latency.
+// --a/--b are re-read for every item; --c writes every product to its own numbered file,
+// otherwise the output stage only checksums C.
+template <typename MyType>
+void runStreamTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    for (const std::string& path : {opts.loadA, opts.loadB}) {
+        if (!path.empty()) {
+            MatrixFileInfo info = probeMatrixFile(path);
+            if (info.rows != info.cols) {
+                throw std::runtime_error(path + ": matrix must be square");
+            }
+            NUM_ARR = info.rows;
+        }
+    }
+
+    std::vector<StreamSlot<MyType>> slots(2 * opts.depth + 3);
+    for (StreamSlot<MyType>& slot : slots) {
+        slot.A = allocateMatrix<MyType>(NUM_ARR);
+        slot.B = allocateMatrix<MyType>(NUM_ARR);
+        slot.C = allocateMatrix<MyType>(NUM_ARR);
+    }
+    const gemm::Options<MyType> options = gemmOptions<MyType>(opts, numThreads);
+
+    auto produce = [&](StreamSlot<MyType>& slot, size_t) {
+        if (opts.loadA.empty()) {
+            RandomElements(slot.A, NUM_ARR);
+        } else {
+            loadMatrix(opts.loadA, slot.A, NUM_ARR, NUM_ARR);
+        }
+        if (opts.loadB.empty()) {
+            RandomElements(slot.B, NUM_ARR);
+        } else {
+            loadMatrix(opts.loadB, slot.B, NUM_ARR, NUM_ARR);
+        }
+    };
+    auto compute = [&](StreamSlot<MyType>& slot, size_t) {
+        gemm::gemm<MyType>(ctx, gemm::view(slot.A, NUM_ARR, NUM_ARR), gemm::view(slot.B, NUM_ARR, NUM_ARR),
+                           gemm::view(slot.C, NUM_ARR, NUM_ARR), options);
+    };
+    auto consume = [&](StreamSlot<MyType>& slot, size_t n) {
+        if (!opts.saveC.empty()) {
+            saveMatrix(streamItemPath(opts.saveC, n), slot.C, NUM_ARR, NUM_ARR);
+            return;
+        }
+        double sum = 0;
+        for (size_t i = 0; i < NUM_ARR; i++) {
+            for (size_t j = 0; j < NUM_ARR; j++) {
+                sum += static_cast<double>(slot.C[i][j]);
+            }
+        }
+        slot.checksum = sum;
+    };
+
+    std::cout << "TESTING STREAM {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>() << ", items:" << opts.items
+              << ", depth:" << opts.depth << ", kernel:" << gemm::algorithmName(opts.kernel)
+              << ", backend:" << gemm::backendName(opts.backend) << "}" << std::endl;
+
+    PipelineReport serialAll, pipelinedAll;
+    auto accumulate = [](PipelineReport& total, const PipelineReport& run) {
+        total.items += run.items;
+        total.seconds += run.seconds;
+        for (int s = 0; s < 3; s++) {
+            total.stageSeconds[s] += run.stageSeconds[s];
+        }
+        total.latencies.insert(total.latencies.end(), run.latencies.begin(), run.latencies.end());
+    };
+
+    for (int r = 0; r < ROUND; r++) {
+        PipelineReport serial = runSerial(slots[0], opts.items, produce, compute, consume);
+        PipelineReport pipelined = runPipeline(slots, opts.items, opts.depth, produce, compute, consume);
+        accumulate(serialAll, serial);
+        accumulate(pipelinedAll, pipelined);
+
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        printStreamReport("Serial", serial);
+        printStreamReport("Pipelined", pipelined);
+    }
+
+    std::cout << "Summary: " << std::endl;
+    printStreamReport("Serial", serialAll);
+    printStreamReport("Pipelined", pipelinedAll);
+    std::cout << "Stage busy time per item (load, multiply, write): " << pipelinedAll.stageSeconds[0] / pipelinedAll.items
+              << ", " << pipelinedAll.stageSeconds[1] / pipelinedAll.items << ", "
+              << pipelinedAll.stageSeconds[2] / pipelinedAll.items << " seconds" << std::endl;
+    std::cout << "Speedup: " << pipelinedAll.throughput() / serialAll.throughput() << std::endl;
+
+    for (StreamSlot<MyType>& slot : slots) {
+        deallocateMatrix(slot.A, NUM_ARR);
+        deallocateMatrix(slot.B, NUM_ARR);
+        deallocateMatrix(slot.C, NUM_ARR);
+    }
+}
+
+// Strong (N fixed) or weak (N^3 / threads fixed) scaling of the RC product over 1, 2, 4, ...
+// numThreads threads, for every backend in one process. The matrices are allocated once at
+// the largest size and smaller runs use their top-left corner. Each thread count gets its
+// own context, so the pool backend has exactly that many threads.
+template <typename MyType>
+void runScalingTest(size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts, ScalingKind kind) {
+    const size_t maxN = scalingSize(kind, NUM_ARR, numThreads);
+    MyType** A = allocateMatrix<MyType>(maxN);
+    MyType** B = allocateMatrix<MyType>(maxN);
+    MyType** C = allocateMatrix<MyType>(maxN);
+    RandomElements(A, maxN);
+    RandomElements(B, maxN);
+
+    std::cout << "TESTING " << (kind == ScalingKind::Strong ? "STRONG" : "WEAK") << " SCALING {size:" << NUM_ARR
+              << ", type:" << demangleTypeName<MyType>() << ", kernel:" << gemm::algorithmName(opts.kernel)
+              << ", threads:1.." << numThreads << "}" << std::endl;
+
+    for (gemm::Backend backend : {gemm::Backend::Pthread, gemm::Backend::Pool, gemm::Backend::Async}) {
+        std::unique_ptr<gemm::Context> pointCtx;
+        auto measure = [&](int threads, size_t n) {
+            if (!pointCtx || pointCtx->threads() != threads) {
+                pointCtx = std::make_unique<gemm::Context>(threads);
+            }
+            gemm::Options<MyType> options = gemmOptions<MyType>(opts, threads);
+            options.backend = backend;
+            auto start_time = std::chrono::high_resolution_clock::now();
+            gemm::gemm<MyType>(*pointCtx, gemm::view(A[0], n, n, maxN), gemm::view(B[0], n, n, maxN),
+                               gemm::view(C[0], n, n, maxN), options);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double>(end_time - start_time).count();
+        };
+        printScalingTable(std::cout, gemm::backendName(backend), kind, runScaling(kind, NUM_ARR, numThreads, ROUND, measure));
+    }
+
+    deallocateMatrix(A, maxN);
+    deallocateMatrix(B, maxN);
+    deallocateMatrix(C, maxN);
+}
+
+// Integer products on the same [0, --range] inputs: the plain int kernels (sums in int,
+// wrong once they pass 2^31), integerGemm over int with --acc/--overflow, and integerGemm
+// over int16 and int8 copies when the range fits. Every result is checked against exact
+// 64-bit sums, clamped to int as the saturating paths do. Throughput is 2 N^3 / t in GOP/s.
+void runIntegerTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    const size_t elements = NUM_ARR * NUM_ARR;
+    const bool fits16 = opts.range <= INT16_MAX;
+    const bool fits8 = opts.range <= INT8_MAX;
+    std::vector<int> A(elements), B(elements), C(elements);
+    std::vector<int16_t> A16(fits16 ? elements : 0), B16(fits16 ? elements : 0);
+    std::vector<int8_t> A8(fits8 ? elements : 0), B8(fits8 ? elements : 0);
+    std::vector<long long> A64(elements), B64(elements), Exact(elements);
+
+    gemm::IntegerOptions options;
+    options.accumulator = opts.accumulator;
+    options.overflow = opts.overflow;
+    options.backend = opts.backend;
+    options.threads = numThreads;
+
+    const std::vector<std::string> names = {"int", "int exact", "int16", "int8"};
+    std::vector<double> totalTime(names.size(), 0);
+    std::vector<size_t> totalWrong(names.size(), 0);
+    const double ops = 2.0 * NUM_ARR * NUM_ARR * NUM_ARR;
+
+    std::cout << "TESTING INTEGER {size:" << NUM_ARR << ", range:0.." << opts.range
+              << ", accumulator:" << gemm::accumulatorName(opts.accumulator)
+              << ", overflow:" << (opts.overflow == gemm::OverflowPolicy::Detect ? "detect" : "saturate")
+              << ", backend:" << gemm::backendName(opts.backend) << "}" << std::endl;
+
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    std::uniform_int_distribution<int> dis(0, opts.range);
+    for (int r = 0; r < ROUND; r++) {
+        for (size_t e = 0; e < elements; e++) {
+            A[e] = dis(gen);
+            B[e] = dis(gen);
+            A64[e] = A[e];
+            B64[e] = B[e];
+            if (fits16) {
+                A16[e] = static_cast<int16_t>(A[e]);
+                B16[e] = static_cast<int16_t>(B[e]);
+            }
+            if (fits8) {
+                A8[e] = static_cast<int8_t>(A[e]);
+                B8[e] = static_cast<int8_t>(B[e]);
+            }
+        }
+        gemm::Options<long long> exact;
+        exact.algorithm = gemm::Algorithm::Rows;
+        exact.threads = numThreads;
+        gemm::gemm<long long>(ctx, gemm::view(A64.data(), NUM_ARR, NUM_ARR), gemm::view(B64.data(), NUM_ARR, NUM_ARR),
+                              gemm::view(Exact.data(), NUM_ARR, NUM_ARR), exact);
+
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        for (size_t p = 0; p < names.size(); p++) {
+            if ((p == 2 && !fits16) || (p == 3 && !fits8)) {
+                continue;
+            }
+            gemm::IntegerReport report;
+            auto start_time = std::chrono::high_resolution_clock::now();
+            if (p == 0) {
+                gemm::gemm<int>(ctx, gemm::view(A.data(), NUM_ARR, NUM_ARR), gemm::view(B.data(), NUM_ARR, NUM_ARR),
+                                gemm::view(C.data(), NUM_ARR, NUM_ARR), gemmOptions<int>(opts, numThreads));
+            } else if (p == 1) {
+                report = gemm::integerGemm<int>(ctx, gemm::view(A.data(), NUM_ARR, NUM_ARR),
+                                                gemm::view(B.data(), NUM_ARR, NUM_ARR), gemm::view(C.data(), NUM_ARR, NUM_ARR),
+                                                options);
+            } else if (p == 2) {
+                report = gemm::integerGemm<int16_t>(ctx, gemm::view(A16.data(), NUM_ARR, NUM_ARR),
+                                                    gemm::view(B16.data(), NUM_ARR, NUM_ARR),
+                                                    gemm::view(C.data(), NUM_ARR, NUM_ARR), options);
+            } else {
+                report = gemm::integerGemm<int8_t>(ctx, gemm::view(A8.data(), NUM_ARR, NUM_ARR),
+                                                   gemm::view(B8.data(), NUM_ARR, NUM_ARR),
+                                                   gemm::view(C.data(), NUM_ARR, NUM_ARR), options);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+
+            size_t wrong = 0;
+            for (size_t e = 0; e < elements; e++) {
+                long long expected = std::min<long long>(INT_MAX, std::max<long long>(INT_MIN, Exact[e]));
+                wrong += C[e] != expected;
+            }
+            totalTime[p] += elapsed.count();
+            totalWrong[p] += wrong;
+            std::cout << "Execution Time " << names[p] << " product: " << elapsed.count() << " seconds ("
+                      << ops / elapsed.count() / 1e9 << " GOP/s, " << wrong << " wrong";
+            if (p > 0) {
+                std::cout << ", " << gemm::accumulatorName(report.used) << " accumulator, " << report.saturated
+                          << " saturated";
+            }
+            std::cout << ")" << std::endl;
+        }
+    }
+
+    std::cout << "Summary: " << std::endl;
+    for (size_t p = 0; p < names.size(); p++) {
+        if ((p == 2 && !fits16) || (p == 3 && !fits8)) {
+            std::cout << names[p] << " product: skipped, range does not fit" << std::endl;
+            continue;
+        }
+        std::cout << "Average Execution Time for " << names[p] << " product: " << totalTime[p] / ROUND << " seconds ("
+                  << ops * ROUND / totalTime[p] / 1e9 << " GOP/s, " << totalWrong[p] << " wrong results)" << std::endl;
+    }
+}
+
+// Random graph in S: each edge present with probability density, weight in [1, 99]
+// (in (0, 1] for max-times, 1 for or-and), absent edges are S::zero()
+template <typename S>
+void RandomSemiringElements(std::vector<typename S::value_type>& M, const double density, std::default_random_engine& gen) {
+    using V = typename S::value_type;
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    for (V& v : M) {
+        if (coin(gen) >= density) {
+            v = S::zero();
+        } else if constexpr (std::is_same<S, gemm::OrAnd>::value) {
+            v = 1;
+        } else if constexpr (std::is_same<S, gemm::MaxTimes<V>>::value && std::is_floating_point<V>::value) {
+            v = static_cast<V>(1.0 - coin(gen));
+        } else {
+            v = static_cast<V>(1 + coin(gen) * 98);
+        }
+    }
+}
+
+// One timed semiringGemm, checked against the naive kernel on the first rows
+template <typename S>
+double measureSemiring(gemm::Context& ctx, const std::vector<typename S::value_type>& A,
+                       const std::vector<typename S::value_type>& B, std::vector<typename S::value_type>& C,
+                       const size_t NUM_ARR, const gemm::SemiringOptions& options, size_t& wrong) {
+    using V = typename S::value_type;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    gemm::semiringGemm<S>(ctx, gemm::view(A.data(), NUM_ARR, NUM_ARR), gemm::view(B.data(), NUM_ARR, NUM_ARR),
+                          gemm::view(C.data(), NUM_ARR, NUM_ARR), options);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    const size_t rows = std::min<size_t>(NUM_ARR, 16);
+    std::vector<V> check(rows * NUM_ARR);
+    gemm::SemiringOptions naive;
+    naive.algorithm = gemm::Algorithm::Naive;
+    naive.threads = 1;
+    gemm::semiringGemm<S>(ctx, gemm::view(A.data(), rows, NUM_ARR), gemm::view(B.data(), NUM_ARR, NUM_ARR),
+                          gemm::view(check.data(), rows, NUM_ARR), naive);
+    for (size_t e = 0; e < check.size(); e++) {
+        const double diff = std::abs(static_cast<double>(C[e]) - static_cast<double>(check[e]));
+        wrong += C[e] != check[e] && !(diff <= 1e-4 * std::abs(static_cast<double>(check[e])));
+    }
+    return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+// Graph products through the semiring machinery with --kernel's algorithm: min-plus and
+// max-times over MyType, or-and over bytes, and plus-times next to gemm::gemm to show
+// what the generic kernel costs. Edges are present with probability --density (default
+// 0.1). Results are checked against the naive loop on the first 16 rows.
+template <typename MyType>
+void runSemiringTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    const double density = opts.density > 0 ? opts.density : 0.1;
+    const size_t elements = NUM_ARR * NUM_ARR;
+    std::vector<MyType> A(elements), B(elements), C(elements);
+    std::vector<uint8_t> A8(elements), B8(elements), C8(elements);
+
+    gemm::SemiringOptions options;
+    options.algorithm = opts.kernel;
+    options.backend = opts.backend;
+    options.threads = numThreads;
+
+    const std::vector<std::string> names = {"plus-times (gemm)", "plus-times (semiring)", "min-plus", "max-times", "or-and"};
+    std::vector<double> totalTime(names.size(), 0);
+    std::vector<size_t> totalWrong(names.size(), 0);
+    const double ops = 2.0 * NUM_ARR * NUM_ARR * NUM_ARR;
+
+    std::cout << "TESTING SEMIRING {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>() << ", density:" << density
+              << ", kernel:" << gemm::algorithmName(opts.kernel) << ", backend:" << gemm::backendName(opts.backend) << "}"
+              << std::endl;
+
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    for (int r = 0; r < ROUND; r++) {
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        for (size_t p = 0; p < names.size(); p++) {
+            double seconds = 0;
+            size_t wrong = 0;
+            if (p == 0) {
+                RandomSemiringElements<gemm::PlusTimes<MyType>>(A, density, gen);
+                RandomSemiringElements<gemm::PlusTimes<MyType>>(B, density, gen);
+                gemm::Options<MyType> plain = gemmOptions<MyType>(opts, numThreads);
+                auto start_time = std::chrono::high_resolution_clock::now();
+                gemm::gemm<MyType>(ctx, gemm::view(A.data(), NUM_ARR, NUM_ARR), gemm::view(B.data(), NUM_ARR, NUM_ARR),
+                                   gemm::view(C.data(), NUM_ARR, NUM_ARR), plain);
+                seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+            } else if (p == 1) {
+                seconds = measureSemiring<gemm::PlusTimes<MyType>>(ctx, A, B, C, NUM_ARR, options, wrong);
+            } else if (p == 2) {
+                RandomSemiringElements<gemm::MinPlus<MyType>>(A, density, gen);
+                RandomSemiringElements<gemm::MinPlus<MyType>>(B, density, gen);
+                seconds = measureSemiring<gemm::MinPlus<MyType>>(ctx, A, B, C, NUM_ARR, options, wrong);
+            } else if (p == 3) {
+                RandomSemiringElements<gemm::MaxTimes<MyType>>(A, density, gen);
+                RandomSemiringElements<gemm::MaxTimes<MyType>>(B, density, gen);
+                seconds = measureSemiring<gemm::MaxTimes<MyType>>(ctx, A, B, C, NUM_ARR, options, wrong);
+            } else {
+                RandomSemiringElements<gemm::OrAnd>(A8, density, gen);
+                RandomSemiringElements<gemm::OrAnd>(B8, density, gen);
+                seconds = measureSemiring<gemm::OrAnd>(ctx, A8, B8, C8, NUM_ARR, options, wrong);
+            }
+            totalTime[p] += seconds;
+            totalWrong[p] += wrong;
+            std::cout << "Execution Time " << names[p] << " product: " << seconds << " seconds ("
+                      << ops / seconds / 1e9 << " G semiring ops/s)" << std::endl;
+        }
+    }
+
+    std::cout << "Summary: " << std::endl;
+    for (size_t p = 0; p < names.size(); p++) {
+        std::cout << "Average Execution Time for " << names[p] << " product: " << totalTime[p] / ROUND << " seconds ("
+                  << ops * ROUND / totalTime[p] / 1e9 << " G semiring ops/s";
+        if (p > 0) {
+            std::cout << ", " << totalWrong[p] << " wrong in checked rows";
+        }
+        std::cout << ")" << std::endl;
+    }
+}
+
+// std::complex<MyType> products: direct (the semiring kernel on complex values) against
+// 4M and 3M, which run on the real gemm with --kernel/--backend. Reports GFLOP/s at 8 real
+// flops per complex multiply-add and the largest difference from the direct result.
+template <typename MyType>
+void runComplexTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    if constexpr (!std::is_floating_point<MyType>::value) {
+        throw std::runtime_error("--mode=complex runs on type float or double");
+    } else {
+        using Complex = std::complex<MyType>;
+        const size_t elements = NUM_ARR * NUM_ARR;
+        std::vector<Complex> A(elements), B(elements), Direct(elements), C(elements);
+        const gemm::ComplexMethod methods[] = {gemm::ComplexMethod::Direct, gemm::ComplexMethod::FourM,
+                                               gemm::ComplexMethod::ThreeM};
+        double totalTime[3] = {0, 0, 0}, maxDiff[3] = {0, 0, 0};
+        const double flops = 8.0 * NUM_ARR * NUM_ARR * NUM_ARR;
+
+        std::cout << "TESTING COMPLEX {size:" << NUM_ARR << ", type:" << demangleTypeName<Complex>()
+                  << ", kernel:" << gemm::algorithmName(opts.kernel) << ", backend:" << gemm::backendName(opts.backend)
+                  << "}" << std::endl;
+
+        std::random_device rd;
+        std::default_random_engine gen(rd());
+        std::uniform_real_distribution<MyType> dis(-1, 1);
+        for (int r = 0; r < ROUND; r++) {
+            for (size_t e = 0; e < elements; e++) {
+                A[e] = {dis(gen), dis(gen)};
+                B[e] = {dis(gen), dis(gen)};
+            }
+            std::cout << "Round " << r + 1 << ":" << std::endl;
+            for (int m = 0; m < 3; m++) {
+                gemm::ComplexOptions options;
+                options.method = methods[m];
+                options.algorithm = opts.kernel;
+                options.backend = opts.backend;
+                options.threads = numThreads;
+                std::vector<Complex>& out = m == 0 ? Direct : C;
+                auto start_time = std::chrono::high_resolution_clock::now();
+                gemm::complexGemm<MyType>(ctx, gemm::view(A.data(), NUM_ARR, NUM_ARR),
+                                          gemm::view(B.data(), NUM_ARR, NUM_ARR), gemm::view(out.data(), NUM_ARR, NUM_ARR),
+                                          options);
+                std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+                totalTime[m] += elapsed.count();
+                for (size_t e = 0; m > 0 && e < elements; e++) {
+                    maxDiff[m] = std::max(maxDiff[m], static_cast<double>(std::abs(C[e] - Direct[e])) /
+                                                          std::max<double>(1, std::abs(Direct[e])));
+                }
+                std::cout << "Execution Time " << gemm::complexMethodName(methods[m]) << " product: " << elapsed.count()
+                          << " seconds (" << flops / elapsed.count() / 1e9 << " GFLOP/s)" << std::endl;
+            }
+        }
+
+        std::cout << "Summary: " << std::endl;
+        for (int m = 0; m < 3; m++) {
+            std::cout << "Average Execution Time for " << gemm::complexMethodName(methods[m]) << " product: "
+                      << totalTime[m] / ROUND << " seconds (" << flops * ROUND / totalTime[m] / 1e9 << " GFLOP/s";
+            if (m > 0) {
+                std::cout << ", max relative difference " << maxDiff[m];
+            }
+            std::cout << ")" << std::endl;
+        }
+        std::cout << "Speedup 4m over direct: " << totalTime[0] / totalTime[1] << std::endl;
+        std::cout << "Speedup 3m over 4m: " << totalTime[1] / totalTime[2] << std::endl;
+    }
+}
+
+// A service-like sequence of --items products per round: B cycles through --operands
+// distinct matrices and a --repeat share of the products repeat an earlier (A, B) pair.
+// Every product runs once without and once with a cache of --cache MiB (default 256);
+// both results must agree exactly, and the cache's hits, misses and time saved are printed.
+template <typename MyType>
+void runCacheTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    const size_t items = opts.items;
+    const size_t budget = (opts.cacheMiB > 0 ? opts.cacheMiB : 256) << 20;
+    gemm::ProductCache cache(budget);
+    gemm::Options<MyType> plain = gemmOptions<MyType>(opts, numThreads);
+    gemm::Options<MyType> cached = plain;
+    cached.cache = &cache;
+
+    std::vector<MyType**> As, Bs(std::min(opts.operands, items));
+    for (MyType**& B : Bs) {
+        B = allocateMatrix<MyType>(NUM_ARR);
+    }
+    MyType** C_Plain = allocateMatrix<MyType>(NUM_ARR);
+    MyType** C_Cached = allocateMatrix<MyType>(NUM_ARR);
+
+    std::cout << "TESTING CACHE {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>() << ", items:" << items
+              << ", operands:" << Bs.size() << ", repeat:" << opts.repeat << ", budget:" << (budget >> 20) << " MiB"
+              << ", kernel:" << gemm::algorithmName(opts.kernel) << ", backend:" << gemm::backendName(opts.backend)
+              << "}" << std::endl;
+
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    std::bernoulli_distribution repeatDraw(opts.repeat);
+    double plainTotal = 0, cachedTotal = 0;
+    size_t mismatches = 0;
+    for (int r = 0; r < ROUND; r++) {
+        for (MyType** B : Bs) {
+            RandomElements(B, NUM_ARR);
+        }
+        // (A index, B index) per product; a repeat copies an earlier pair
+        std::vector<std::pair<size_t, size_t>> sequence;
+        size_t distinctA = 0;
+        for (size_t n = 0; n < items; n++) {
+            if (n > 0 && repeatDraw(gen)) {
+                sequence.push_back(sequence[std::uniform_int_distribution<size_t>(0, n - 1)(gen)]);
+                continue;
+            }
+            if (distinctA == As.size()) {
+                As.push_back(allocateMatrix<MyType>(NUM_ARR));
+            }
+            RandomElements(As[distinctA], NUM_ARR);
+            sequence.push_back({distinctA++, n % Bs.size()});
+        }
+
+        double plainTime = 0, cachedTime = 0;
+        for (const auto& [a, b] : sequence) {
+            auto A_View = gemm::view(As[a], NUM_ARR, NUM_ARR);
+            auto B_View = gemm::view(Bs[b], NUM_ARR, NUM_ARR);
+            auto start_time = std::chrono::high_resolution_clock::now();
+            gemm::gemm<MyType>(ctx, A_View, B_View, gemm::view(C_Plain, NUM_ARR, NUM_ARR), plain);
+            auto middle_time = std::chrono::high_resolution_clock::now();
+            gemm::gemm<MyType>(ctx, A_View, B_View, gemm::view(C_Cached, NUM_ARR, NUM_ARR), cached);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            plainTime += std::chrono::duration<double>(middle_time - start_time).count();
+            cachedTime += std::chrono::duration<double>(end_time - middle_time).count();
+            mismatches += std::memcmp(C_Plain[0], C_Cached[0], NUM_ARR * NUM_ARR * sizeof(MyType)) != 0;
+        }
+        plainTotal += plainTime;
+        cachedTotal += cachedTime;
+        std::cout << "Round " << r + 1 << ":" << std::endl;
+        std::cout << "Execution Time uncached: " << plainTime << " seconds (" << distinctA << " distinct A, "
+                  << items - distinctA << " repeats)" << std::endl;
+        std::cout << "Execution Time cached: " << cachedTime << " seconds" << std::endl;
+    }
+
+    std::cout << "Summary: " << std::endl;
+    std::cout << "Average Execution Time for uncached products: " << plainTotal / ROUND << " seconds" << std::endl;
+    std::cout << "Average Execution Time for cached products: " << cachedTotal / ROUND << " seconds" << std::endl;
+    std::cout << "Speedup: " << plainTotal / cachedTotal << std::endl;
+    std::cout << "Results differing from uncached: " << mismatches << std::endl;
+    gemm::printCacheReport(std::cout, cache);
+
+    for (MyType** A : As) {
+        deallocateMatrix(A, NUM_ARR);
+    }
+    for (MyType** B : Bs) {
+        deallocateMatrix(B, NUM_ARR);
+    }
+    deallocateMatrix(C_Plain, NUM_ARR);
+    deallocateMatrix(C_Cached, NUM_ARR);
+}
+
+// Largest relative difference between two N x N results, each element scaled by max(1, |ref|)
+template <typename T>
+double maxRelativeDiff(const T* C, const T* ref, const size_t elements) {
+    double worst = 0;
+    for (size_t e = 0; e < elements; e++) {
+        double diff = std::abs(static_cast<double>(C[e]) - static_cast<double>(ref[e]));
+        worst = std::max(worst, diff / std::max(1.0, std::abs(static_cast<double>(ref[e]))));
+    }
+    return worst;
+}
+
+// Incremental updates against a full recompute for k = 1, 2, 4, ... N: k rows of A are
+// rewritten and C's rows follow with updateRows, then B takes a rank-k change U * V^T and
+// C follows with lowRankUpdate. After each step the full product with --kernel/--backend
+// is timed into a second C and checks the rank-k update; the updated rows are checked
+// against the naive kernel. The crossover is the first k at which an update is no longer faster.
+template <typename MyType>
+void runIncrementalTest(gemm::Context& ctx, size_t NUM_ARR, const int numThreads, const int ROUND, const BenchOptions& opts) {
+    const size_t elements = NUM_ARR * NUM_ARR;
+    MyType** A = allocateMatrix<MyType>(NUM_ARR);
+    MyType** B = allocateMatrix<MyType>(NUM_ARR);
+    std::vector<MyType> C(elements), Full(elements), U, V;
+    const gemm::Options<MyType> options = gemmOptions<MyType>(opts, numThreads);
+    auto A_View = gemm::view(A, NUM_ARR, NUM_ARR);
+    auto B_View = gemm::view(B, NUM_ARR, NUM_ARR);
+    auto C_View = gemm::view(C.data(), NUM_ARR, NUM_ARR);
+    auto Full_View = gemm::view(Full.data(), NUM_ARR, NUM_ARR);
+
+    std::random_device rd;
+    std::default_random_engine gen(rd());
+    // Low-rank factors stay small so that integer sums keep their headroom
+    auto factor = [&gen]() -> MyType {
+        if constexpr (std::is_integral<MyType>::value) {
+            return static_cast<MyType>(std::uniform_int_distribution<int>(-1, 1)(gen));
+        } else {
+            return static_cast<MyType>(std::uniform_real_distribution<double>(-1, 1)(gen));
+        }
+    };
+    // Same range as RandomElements
+    auto element = [&gen]() -> MyType {
+        if constexpr (std::is_integral<MyType>::value) {
+            return static_cast<MyType>(std::uniform_int_distribution<int>(0, 99)(gen));
+        } else {
+            return static_cast<MyType>(std::uniform_real_distribution<double>(0, 99)(gen));
+        }
+    };
+    gemm::Options<MyType> reference;
+    reference.algorithm = gemm::Algorithm::Naive;
+    reference.threads = 1;
+    std::vector<MyType> referenceRow(NUM_ARR);
+    std::vector<size_t> ranks;
+    for (size_t k = 1; k <= NUM_ARR; k *= 2) {
+        ranks.push_back(k);
+    }
+    std::vector<double> rowTime(ranks.size(), 0), rankTime(ranks.size(), 0), fullTime(ranks.size(), 0);
+    std::vector<double> rowDiff(ranks.size(), 0), rankDiff(ranks.size(), 0);
+
+    std::cout << "TESTING INCREMENTAL {size:" << NUM_ARR << ", type:" << demangleTypeName<MyType>()
+              << ", kernel:" << gemm::algorithmName(opts.kernel) << ", backend:" << gemm::backendName(opts.backend)
+              << "}" << std::endl;
+
+    for (int r = 0; r < ROUND; r++) {
+        RandomElements(A, NUM_ARR);
+        RandomElements(B, NUM_ARR);
+        gemm::gemm<MyType>(ctx, A_View, B_View, C_View, options);
+        for (size_t s = 0; s < ranks.size(); s++) {
+            const size_t k = ranks[s];
+
+            // k distinct rows of A get new elements
+            std::vector<size_t> rows(NUM_ARR);
+            std::iota(rows.begin(), rows.end(), size_t(0));
+            std::shuffle(rows.begin(), rows.end(), gen);
+            rows.resize(k);
+            for (size_t row : rows) {
+                for (size_t j = 0; j < NUM_ARR; j++) {
+                    A[row][j] = element();
+                }
+            }
+            auto start_time = std::chrono::high_resolution_clock::now();
+            gemm::updateRows<MyType>(ctx, A_View, B_View, C_View, rows, options);
+            auto end_time = std::chrono::high_resolution_clock::now();
+            rowTime[s] += std::chrono::duration<double>(end_time - start_time).count() / ROUND;
+            for (size_t row : rows) {
+                gemm::gemm<MyType>(ctx, gemm::view<const MyType>(A[row], 1, NUM_ARR), B_View,
+                                   gemm::view(referenceRow.data(), 1, NUM_ARR), reference);
+                rowDiff[s] = std::max(rowDiff[s], maxRelativeDiff(C_View.row(row), referenceRow.data(), NUM_ARR));
+            }
+
+            // B += U * V^T and C follows
+            U.resize(NUM_ARR * k);
+            V.resize(NUM_ARR * k);
+            for (MyType& u : U) {
+                u = factor();
+            }
+            for (MyType& v : V) {
+                v = factor();
+            }
+            auto U_View = gemm::view<const MyType>(U.data(), NUM_ARR, k);
+            auto V_View = gemm::view<const MyType>(V.data(), NUM_ARR, k);
+            start_time = std::chrono::high_resolution_clock::now();
+            gemm::lowRankUpdate<MyType>(ctx, A_View, U_View, V_View, C_View, options);
+            end_time = std::chrono::high_resolution_clock::now();
+            rankTime[s] += std::chrono::duration<double>(end_time - start_time).count() / ROUND;
+            gemm::addLowRank<MyType>(ctx, B_View, U_View, V_View, gemm::Op::None, options);
+
+            // The rank-k update against a full recompute of the new A * B
+            start_time = std::chrono::high_resolution_clock::now();
+            gemm::gemm<MyType>(ctx, A_View, B_View, Full_View, options);
+            end_time = std::chrono::high_resolution_clock::now();
+            fullTime[s] += std::chrono::duration<double>(end_time - start_time).count() / ROUND;
+            rankDiff[s] = std::max(rankDiff[s], maxRelativeDiff(C.data(), Full.data(), elements));
+            // Start the next step from the reference so drift does not carry over
+            C = Full;
+        }
+    }
+
+    std::cout << "Summary: " << std::endl;
+    std::cout << std::setw(8) << "k" << std::setw(14) << "rows s" << std::setw(14) << "rank-k s" << std::setw(14)
+              << "full s" << std::setw(14) << "rows speedup" << std::setw(14) << "rank speedup" << std::setw(14)
+              << "rows diff" << std::setw(14) << "rank diff" << std::endl;
+    size_t rowCrossover = 0, rankCrossover = 0;
+    for (size_t s = 0; s < ranks.size(); s++) {
+        if (!rowCrossover && rowTime[s] >= fullTime[s]) {
+            rowCrossover = ranks[s];
+        }
+        if (!rankCrossover && rankTime[s] >= fullTime[s]) {
+            rankCrossover = ranks[s];
+        }
+        std::cout << std::setw(8) << ranks[s] << std::setw(14) << rowTime[s] << std::setw(14) << rankTime[s]
+                  << std::setw(14) << fullTime[s] << std::setw(14) << fullTime[s] / rowTime[s] << std::setw(14)
+                  << fullTime[s] / rankTime[s] << std::setw(14) << rowDiff[s] << std::setw(14) << rankDiff[s]
+                  << std::endl;
+    }
+    auto printCrossover = [NUM_ARR](const char* name, size_t k) {
+        std::cout << "Crossover " << name << ": ";
+        if (k) {
+            std::cout << "full recompute is as fast from k = " << k << " (" << 100.0 * k / NUM_ARR << "% of N)";
+        } else {
+            std::cout << "incremental faster up to k = N";
+        }
+        std::cout << std::endl;
+    };
+    printCrossover("row updates", rowCrossover);
+    printCrossover("rank-k updates", rankCrossover);
+
+    deallocateMatrix(A, NUM_ARR);
+    deallocateMatrix(B, NUM_ARR);
+}
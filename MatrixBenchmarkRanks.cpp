@@ -0,0 +1,38 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "MatrixComm.hpp"
+#include "MatrixBuild.hpp"
+
+// The MPI+OpenMP driver's distributed product with the ranks emulated by threads of this
+// process (LocalComm), so it can be developed and measured without mpirun
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " <ranks> <scale> [round=3] [panel=scale/8]\n";
+        return 1;
+    }
+
+    try {
+        const int ranks = std::stoi(argv[1]);
+        const size_t N = static_cast<size_t>(std::stoul(argv[2]));
+        const int round = argc >= 4 ? std::stoi(argv[3]) : 3;
+        const size_t panel = argc == 5 ? static_cast<size_t>(std::stoul(argv[4])) : std::max<size_t>(1, N / 8);
+        if (ranks <= 0 || round <= 0) {
+            throw std::runtime_error("ranks and round must be positive");
+        }
+
+        printBuildInfo(std::cout);
+        std::cout << "TESTING RANKS {ranks:" << ranks << ", scale:" << N << ", panel:" << panel << "}" << std::endl;
+        LocalWorld world(ranks);
+        world.run([&](LocalComm& comm) {
+            // Only root prints; the stream is handed over whole so the table is not interleaved
+            std::ostringstream out;
+            benchmarkDistributed(comm, N, round, panel, out);
+            std::cout << out.str();
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
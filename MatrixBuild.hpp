@@ -0,0 +1,20 @@
+#pragma once
+
+#include <ostream>
+#include "MatrixDispatch.hpp"
+
+// Compiler, flags and kernel variants of this binary, printed at the top of every
+// benchmark run so results can be traced back to how they were built
+#if __has_include("MatrixBuildInfo.hpp")
+#include "MatrixBuildInfo.hpp"
+#else
+#define MATRIX_BUILD_COMPILER "g++ " __VERSION__
+#define MATRIX_BUILD_TYPE "manual"
+#define MATRIX_BUILD_FLAGS "unknown (not built with CMake)"
+#define MATRIX_BUILD_ISAS "compile-time"
+#endif
+
+inline void printBuildInfo(std::ostream& os) {
+    os << "BUILD {compiler:" << MATRIX_BUILD_COMPILER << ", type:" << MATRIX_BUILD_TYPE
+       << ", flags:" << MATRIX_BUILD_FLAGS << ", isa:" << matrixIsaName() << " of " << MATRIX_BUILD_ISAS << "}" << std::endl;
+}
@@ -0,0 +1,147 @@
+#include "MatrixCache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <new>
+
+namespace gemm {
+
+namespace {
+
+constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+
+inline uint64_t mix(uint64_t h, uint64_t word) {
+    h ^= word;
+    h *= kMultiplier;
+    return h ^ (h >> 29);
+}
+
+}  // namespace
+
+// Four independent lanes so the multiplies of consecutive words overlap
+uint64_t hashRows(const void* data, size_t rows, size_t rowBytes, size_t strideBytes) {
+    uint64_t lane[4] = {1, 2, 3, 4};
+    const unsigned char* base = static_cast<const unsigned char*>(data);
+    for (size_t r = 0; r < rows; r++) {
+        const unsigned char* p = base + r * strideBytes;
+        size_t b = 0;
+        for (; b + 32 <= rowBytes; b += 32) {
+            uint64_t w[4];
+            std::memcpy(w, p + b, 32);
+            for (int l = 0; l < 4; l++) {
+                lane[l] = mix(lane[l], w[l]);
+            }
+        }
+        for (; b < rowBytes; b += 8) {
+            uint64_t w = 0;
+            std::memcpy(&w, p + b, std::min<size_t>(8, rowBytes - b));
+            lane[0] = mix(lane[0], w);
+        }
+        lane[1] = mix(lane[1], r);
+    }
+    uint64_t h = rows * kMultiplier ^ rowBytes;
+    for (uint64_t l : lane) {
+        h = mix(h, l);
+    }
+    return h;
+}
+
+ProductCache::ProductCache(size_t budgetBytes) : budgetBytes(budgetBytes) {}
+
+std::shared_ptr<void> ProductCache::allocate(size_t bytes) {
+    void* ptr = std::aligned_alloc(64, (std::max<size_t>(1, bytes) + 63) / 64 * 64);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return std::shared_ptr<void>(ptr, std::free);
+}
+
+std::shared_ptr<const void> ProductCache::find(const CacheKey& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    CacheStats& stats = key.kind == CacheKind::PackedB ? packed : results;
+    auto it = table.find(key);
+    if (it == table.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+    stats.secondsSaved += it->second.seconds;
+    recency.splice(recency.begin(), recency, it->second.position);
+    return it->second.data;
+}
+
+void ProductCache::insert(const CacheKey& key, std::shared_ptr<void> data, size_t bytes, double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > budgetBytes || table.count(key)) {
+        return;
+    }
+    while (used + bytes > budgetBytes) {
+        auto oldest = table.find(recency.back());
+        used -= oldest->second.bytes;
+        table.erase(oldest);
+        recency.pop_back();
+        evicted++;
+    }
+    recency.push_front(key);
+    table.emplace(key, Entry{std::move(data), bytes, seconds, recency.begin()});
+    used += bytes;
+}
+
+void ProductCache::addHashTime(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    hashing += seconds;
+}
+
+CacheStats ProductCache::stats(CacheKind kind) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return kind == CacheKind::PackedB ? packed : results;
+}
+
+double ProductCache::hashSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hashing;
+}
+
+size_t ProductCache::entries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return table.size();
+}
+
+size_t ProductCache::evictions() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return evicted;
+}
+
+size_t ProductCache::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+void ProductCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    table.clear();
+    recency.clear();
+    used = 0;
+    evicted = 0;
+    hashing = 0;
+    packed = {};
+    results = {};
+}
+
+void printCacheReport(std::ostream& os, const ProductCache& cache) {
+    const CacheStats packed = cache.stats(CacheKind::PackedB);
+    const CacheStats results = cache.stats(CacheKind::Result);
+    os << "Cache: " << cache.entries() << " entries, " << std::fixed << std::setprecision(1)
+       << cache.bytesUsed() / 1048576.0 << " of " << cache.budget() / 1048576.0 << " MiB, " << cache.evictions()
+       << " evictions" << std::defaultfloat << std::setprecision(6) << std::endl;
+    os << "Cache packed B: " << packed.hits << " hits, " << packed.misses << " misses, " << packed.secondsSaved
+       << " seconds saved" << std::endl;
+    os << "Cache results: " << results.hits << " hits, " << results.misses << " misses, " << results.secondsSaved
+       << " seconds saved" << std::endl;
+    os << "Cache hashing: " << cache.hashSeconds() << " seconds; net time saved "
+       << packed.secondsSaved + results.secondsSaved - cache.hashSeconds() << " seconds" << std::endl;
+}
+
+}  // namespace gemm
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <tuple>
+
+// Memo of work that depends only on the operands' contents: the packed right factor of the
+// blocked algorithm and whole products. Operands are identified by a 64-bit hash of their
+// elements, so a repeated B skips packing and a repeated (A, B) pair copies out the stored C:
+//
+//   gemm::ProductCache cache(256 << 20);
+//   options.cache = &cache;
+//
+// Entries are evicted least recently used first once the budget is reached. Hashing reads
+// both operands on every call (O(N^2) against the product's O(N^3)); two different
+// operands with the same hash would be taken for each other.
+namespace gemm {
+
+// Hash of rows x rowBytes bytes, rows strideBytes apart
+uint64_t hashRows(const void* data, size_t rows, size_t rowBytes, size_t strideBytes);
+
+enum class CacheKind { PackedB, Result };
+
+struct CacheKey {
+    CacheKind kind;
+    size_t elemSize;
+    bool integral;
+    size_t M;           // 0 for PackedB
+    size_t K;
+    size_t N;
+    int opB;
+    int algorithm;      // results only: the summation order differs between algorithms
+    uint64_t hashA;     // 0 for PackedB
+    uint64_t hashB;
+
+    bool operator<(const CacheKey& other) const {
+        return std::tie(kind, elemSize, integral, M, K, N, opB, algorithm, hashA, hashB) <
+               std::tie(other.kind, other.elemSize, other.integral, other.M, other.K, other.N, other.opB,
+                        other.algorithm, other.hashA, other.hashB);
+    }
+};
+
+struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    double secondsSaved = 0;    // what the hits cost to compute when they were stored
+};
+
+class ProductCache {
+public:
+    explicit ProductCache(size_t budgetBytes);
+    ProductCache(const ProductCache&) = delete;
+    ProductCache& operator=(const ProductCache&) = delete;
+
+    // 64-byte aligned storage for an entry about to be inserted
+    static std::shared_ptr<void> allocate(size_t bytes);
+
+    // The entry's data, or null on a miss. The pointer keeps the data alive if the entry
+    // is evicted while it is in use.
+    std::shared_ptr<const void> find(const CacheKey& key);
+
+    // Keep data, which took seconds to produce, evicting older entries to fit. Entries
+    // larger than the whole budget are not kept.
+    void insert(const CacheKey& key, std::shared_ptr<void> data, size_t bytes, double seconds);
+
+    // Time spent hashing operands, the cost of looking anything up
+    void addHashTime(double seconds);
+
+    CacheStats stats(CacheKind kind) const;
+    double hashSeconds() const;
+    size_t entries() const;
+    size_t evictions() const;
+    size_t bytesUsed() const;
+    size_t budget() const { return budgetBytes; }
+
+    void clear();
+
+private:
+    struct Entry {
+        std::shared_ptr<void> data;
+        size_t bytes;
+        double seconds;
+        std::list<CacheKey>::iterator position;
+    };
+
+    const size_t budgetBytes;
+    mutable std::mutex mutex;
+    std::map<CacheKey, Entry> table;
+    std::list<CacheKey> recency;    // most recently used first
+    size_t used = 0;
+    size_t evicted = 0;
+    double hashing = 0;
+    CacheStats packed;
+    CacheStats results;
+};
+
+// Hits, misses and time saved per kind, with the hashing time they cost
+void printCacheReport(std::ostream& os, const ProductCache& cache);
+
+}  // namespace gemm
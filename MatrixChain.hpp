@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Parenthesization of A_1 ... A_n where A_i is dims[i-1] x dims[i].
+// split[i][j] is the k at which the product A_i..A_j is split into (A_i..A_k)(A_k+1..A_j).
+struct ChainPlan {
+    std::vector<size_t> dims;
+    std::vector<std::vector<size_t>> split;
+    double flops = 0;
+
+    size_t count() const { return dims.size() - 1; }
+};
+
+// Classic O(n^3) dynamic program over the shapes, minimising scalar multiply-adds
+inline ChainPlan planMatrixChain(const std::vector<size_t>& dims) {
+    const size_t n = dims.size() - 1;
+    ChainPlan plan;
+    plan.dims = dims;
+    plan.split.assign(n + 1, std::vector<size_t>(n + 1, 0));
+    std::vector<std::vector<double>> cost(n + 1, std::vector<double>(n + 1, 0));
+
+    for (size_t len = 2; len <= n; len++) {
+        for (size_t i = 1; i + len - 1 <= n; i++) {
+            size_t j = i + len - 1;
+            cost[i][j] = std::numeric_limits<double>::max();
+            for (size_t k = i; k < j; k++) {
+                double c = cost[i][k] + cost[k + 1][j] + static_cast<double>(dims[i - 1]) * dims[k] * dims[j];
+                if (c < cost[i][j]) {
+                    cost[i][j] = c;
+                    plan.split[i][j] = k;
+                }
+            }
+        }
+    }
+    plan.flops = 2 * cost[1][n];
+    return plan;
+}
+
+// ((A_1 A_2) A_3) ... as the unoptimised reference order
+inline ChainPlan leftToRightChain(const std::vector<size_t>& dims) {
+    const size_t n = dims.size() - 1;
+    ChainPlan plan;
+    plan.dims = dims;
+    plan.split.assign(n + 1, std::vector<size_t>(n + 1, 0));
+    for (size_t j = 2; j <= n; j++) {
+        plan.split[1][j] = j - 1;
+        plan.flops += 2.0 * dims[0] * dims[j - 1] * dims[j];
+    }
+    return plan;
+}
+
+inline std::string chainParenthesization(const ChainPlan& plan, size_t i, size_t j) {
+    if (i == j) {
+        return "A" + std::to_string(i);
+    }
+    size_t k = plan.split[i][j];
+    return "(" + chainParenthesization(plan, i, k) + " " + chainParenthesization(plan, k + 1, j) + ")";
+}
+
+// Intermediate buffers for chain products. Released buffers are kept and handed out
+// again to any request they are large enough for, so repeated chains stop allocating.
+template <typename T>
+class MatrixPool {
+public:
+    T* acquire(size_t count) {
+        Buffer* best = nullptr;
+        for (Buffer& buf : buffers) {
+            if (!buf.inUse && buf.capacity >= count && (!best || buf.capacity < best->capacity)) {
+                best = &buf;
+            }
+        }
+        if (best) {
+            best->inUse = true;
+            reuses++;
+            return best->data.get();
+        }
+        buffers.push_back({std::make_unique<T[]>(count), count, true});
+        allocations++;
+        return buffers.back().data.get();
+    }
+
+    void release(T* ptr) {
+        for (Buffer& buf : buffers) {
+            if (buf.data.get() == ptr) {
+                buf.inUse = false;
+                return;
+            }
+        }
+    }
+
+    size_t allocations = 0;
+    size_t reuses = 0;
+
+private:
+    struct Buffer {
+        std::unique_ptr<T[]> data;
+        size_t capacity;
+        bool inUse;
+    };
+    std::vector<Buffer> buffers;
+};
+
+// Evaluate A_i..A_j following the plan. Leaves are the caller's matrices; every
+// intermediate comes from the pool and is released as soon as it has been consumed.
+// multiply(A, B, C, M, K, N) computes C = A * B. The result must be released by the caller.
+template <typename T, typename Multiply>
+T* executeChain(const ChainPlan& plan, const std::vector<T*>& mats, MatrixPool<T>& pool, Multiply&& multiply,
+                size_t i, size_t j) {
+    if (i == j) {
+        return mats[i - 1];
+    }
+    size_t k = plan.split[i][j];
+    T* left = executeChain(plan, mats, pool, multiply, i, k);
+    T* right = executeChain(plan, mats, pool, multiply, k + 1, j);
+    T* out = pool.acquire(plan.dims[i - 1] * plan.dims[j]);
+    multiply(left, right, out, plan.dims[i - 1], plan.dims[k], plan.dims[j]);
+    if (i != k) {
+        pool.release(left);
+    }
+    if (k + 1 != j) {
+        pool.release(right);
+    }
+    return out;
+}
+
+template <typename T, typename Multiply>
+T* executeChain(const ChainPlan& plan, const std::vector<T*>& mats, MatrixPool<T>& pool, Multiply&& multiply) {
+    return executeChain(plan, mats, pool, multiply, 1, plan.count());
+}
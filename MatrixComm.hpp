@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MatrixEpilogue.hpp"
+#include "MatrixDispatch.hpp"
+#include "MatrixLockFree.hpp"
+
+// The collectives the distributed multiply needs, behind two interchangeable backends:
+// MpiComm (MatrixCommMpi.hpp) over a real MPI communicator, and LocalComm, where the ranks
+// are threads of one process exchanging messages through lock-free mailboxes. Algorithms
+// are templates over the Communicator concept, so the same code runs under mpirun and in
+// a plain binary:
+//
+//   LocalWorld world(4);
+//   world.run([&](LocalComm& comm) { distributedMultiply(comm, A, B, C, N, panel); });
+//
+// Every backend counts the bytes it moves and the time each rank spends in communication.
+// The algorithm reports its compute time; the part of it during which a nonblocking
+// transfer to this rank was still in flight counts as overlap.
+
+struct CommStats {
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t messages = 0;      // point-to-point sends, or collective calls under MPI
+    double commSeconds = 0;     // blocked in collectives and waits, or progressing requests
+    double computeSeconds = 0;
+    double overlapSeconds = 0;  // compute while a nonblocking transfer was in flight
+};
+
+// A nonblocking operation. test() makes progress without blocking and returns true once
+// the data has arrived, setting landed to when it did; finish() blocks until it has.
+struct CommRequest {
+    struct State {
+        std::function<bool(std::chrono::steady_clock::time_point& landed)> test;
+        std::function<void()> finish;
+        bool done = false;
+    };
+    std::shared_ptr<State> state;
+};
+
+// Statistics and request bookkeeping shared by the backends
+class CommBase {
+public:
+    CommStats& stats() { return counters; }
+    const CommStats& stats() const { return counters; }
+
+    void wait(CommRequest& request) {
+        if (!request.state) {
+            return;
+        }
+        if (!request.state->done) {
+            auto start_time = std::chrono::steady_clock::now();
+            request.state->finish();
+            request.state->done = true;
+            counters.commSeconds += elapsedSince(start_time);
+        }
+        std::erase(outstanding, request.state);
+        request.state = nullptr;
+    }
+
+    // fn timed as computation. Outstanding requests are progressed before fn, so those
+    // whose data is already here complete first; of the rest, each counts as in flight
+    // until it landed, as found by testing it again after fn, and fn's time up to the last
+    // landing is overlap
+    template <typename F>
+    void compute(F&& fn) {
+        progress();
+        std::vector<std::shared_ptr<CommRequest::State>> inFlight = outstanding;
+        auto start_time = std::chrono::steady_clock::now();
+        fn();
+        auto end_time = std::chrono::steady_clock::now();
+        counters.computeSeconds += std::chrono::duration<double>(end_time - start_time).count();
+
+        auto latest = start_time;
+        for (const std::shared_ptr<CommRequest::State>& state : inFlight) {
+            auto landed = end_time;
+            auto test_start = std::chrono::steady_clock::now();
+            state->done = state->test(landed);
+            counters.commSeconds += elapsedSince(test_start);
+            latest = std::max(latest, std::min(landed, end_time));
+        }
+        counters.overlapSeconds += std::chrono::duration<double>(latest - start_time).count();
+        std::erase_if(outstanding, [](const auto& state) { return state->done; });
+    }
+
+protected:
+    static double elapsedSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    CommRequest started(std::function<bool(std::chrono::steady_clock::time_point&)> test,
+                        std::function<void()> finish) {
+        auto state = std::make_shared<CommRequest::State>();
+        state->test = std::move(test);
+        state->finish = std::move(finish);
+        outstanding.push_back(state);
+        return {state};
+    }
+
+    // Finished within the call that started it: never in flight
+    static CommRequest completed() {
+        auto state = std::make_shared<CommRequest::State>();
+        state->done = true;
+        return {state};
+    }
+
+    void progress() {
+        auto start_time = std::chrono::steady_clock::now();
+        for (const std::shared_ptr<CommRequest::State>& state : outstanding) {
+            std::chrono::steady_clock::time_point landed;
+            state->done = state->test(landed);
+        }
+        std::erase_if(outstanding, [](const auto& state) { return state->done; });
+        counters.commSeconds += elapsedSince(start_time);
+    }
+
+    CommStats counters;
+    std::vector<std::shared_ptr<CommRequest::State>> outstanding;
+};
+
+// scatter/gather move bytes per rank, in rank order, to or from root's buffer; ibcast
+// returns at once and the data is only valid on every rank after wait()
+template <typename C>
+concept Communicator = std::derived_from<C, CommBase> && requires(C comm, void* p, const void* cp, size_t n, int r) {
+    { comm.rank() } -> std::convertible_to<int>;
+    { comm.size() } -> std::convertible_to<int>;
+    comm.barrier();
+    comm.scatter(cp, p, n, r);
+    comm.gather(cp, p, n, r);
+    { comm.ibcast(p, n, r) } -> std::same_as<CommRequest>;
+};
+
+class LocalWorld;
+
+// One emulated rank. Messages are copied out of the sender's buffer when sent and into the
+// receiver's when received, like an eager MPI protocol; broadcasts follow a binomial tree.
+class LocalComm : public CommBase {
+public:
+    LocalComm(LocalWorld& world, int rank) : world(world), myRank(rank) {}
+
+    int rank() const { return myRank; }
+    int size() const;
+    void barrier();
+
+    void scatter(const void* send, void* recv, size_t bytes, int root) {
+        const int tag = nextTag++;
+        auto start_time = std::chrono::steady_clock::now();
+        if (myRank == root) {
+            const unsigned char* from = static_cast<const unsigned char*>(send);
+            for (int r = 0; r < size(); r++) {
+                if (r == root) {
+                    std::memcpy(recv, from + r * bytes, bytes);
+                } else {
+                    post(r, tag, std::make_shared<std::vector<unsigned char>>(from + r * bytes, from + (r + 1) * bytes));
+                }
+            }
+        } else {
+            deliver(receive(root, tag), recv, bytes);
+        }
+        counters.commSeconds += elapsedSince(start_time);
+    }
+
+    void gather(const void* send, void* recv, size_t bytes, int root) {
+        const int tag = nextTag++;
+        auto start_time = std::chrono::steady_clock::now();
+        if (myRank == root) {
+            unsigned char* to = static_cast<unsigned char*>(recv);
+            std::memcpy(to + root * bytes, send, bytes);
+            for (int r = 0; r < size(); r++) {
+                if (r != root) {
+                    deliver(receive(r, tag), to + r * bytes, bytes);
+                }
+            }
+        } else {
+            const unsigned char* from = static_cast<const unsigned char*>(send);
+            post(root, tag, std::make_shared<std::vector<unsigned char>>(from, from + bytes));
+        }
+        counters.commSeconds += elapsedSince(start_time);
+    }
+
+    // The root sends to its tree children at once and is done. Every other rank takes the
+    // message from its parent, and passes it on to its own children, as soon as it has
+    // arrived: in wait(), or when compute() progresses the request. Until then the panel is
+    // in flight to that rank.
+    CommRequest ibcast(void* data, size_t bytes, int root) {
+        const int tag = nextTag++;
+        const int relative = (myRank - root + size()) % size();
+        if (relative == 0) {
+            auto payload = std::make_shared<std::vector<unsigned char>>(static_cast<unsigned char*>(data),
+                                                                       static_cast<unsigned char*>(data) + bytes);
+            auto start_time = std::chrono::steady_clock::now();
+            int top = 1;
+            while (top < size()) {
+                top <<= 1;
+            }
+            forward(relative, root, tag, payload, top);
+            counters.commSeconds += elapsedSince(start_time);
+            return completed();
+        }
+        int mask = 1;
+        while (!(relative & mask)) {
+            mask <<= 1;
+        }
+        const int parent = (relative - mask + root) % size();
+        auto pass = [this, data, bytes, root, tag, relative, mask](const Message& message) {
+            deliver(message, data, bytes);
+            forward(relative, root, tag, message.payload, mask);
+        };
+        return started(
+            [this, parent, tag, pass](std::chrono::steady_clock::time_point& landed) {
+                Message message;
+                if (!tryReceive(parent, tag, message)) {
+                    return false;
+                }
+                landed = message.posted;
+                pass(message);
+                return true;
+            },
+            [this, parent, tag, pass]() { pass(receive(parent, tag)); });
+    }
+
+private:
+    struct Message {
+        int source = 0;
+        int tag = 0;
+        std::shared_ptr<const std::vector<unsigned char>> payload;
+        std::chrono::steady_clock::time_point posted;
+    };
+
+    void post(int dest, int tag, std::shared_ptr<const std::vector<unsigned char>> payload);
+    // The message from source with tag if it has arrived, without blocking
+    bool tryReceive(int source, int tag, Message& message);
+    Message receive(int source, int tag);
+    // Copy the payload into data, which must hold exactly bytes
+    void deliver(const Message& message, void* data, size_t bytes);
+
+    // Send to relative's children in the binomial tree: relative + m for each power of two m
+    // below `below`, farthest first so the larger subtrees start soonest
+    void forward(int relative, int root, int tag, const std::shared_ptr<const std::vector<unsigned char>>& payload,
+                 int below) {
+        for (int mask = below >> 1; mask > 0; mask >>= 1) {
+            if (relative + mask < size()) {
+                post((relative + mask + root) % size(), tag, payload);
+            }
+        }
+    }
+
+    friend class LocalWorld;
+
+    LocalWorld& world;
+    const int myRank;
+    int nextTag = 0;            // collectives run in the same order on every rank
+    std::deque<Message> early;  // arrived before their receive was posted
+};
+
+// Threads standing in for the ranks, one mailbox each
+class LocalWorld {
+public:
+    explicit LocalWorld(int ranks, size_t mailboxCapacity = 1024) : sync(ranks) {
+        if (ranks <= 0) {
+            throw std::runtime_error("LocalWorld needs at least one rank");
+        }
+        for (int r = 0; r < ranks; r++) {
+            boxes.push_back(std::make_unique<Mailbox>(mailboxCapacity));
+        }
+    }
+
+    int size() const { return static_cast<int>(boxes.size()); }
+
+    // body(comm) on one thread per rank; returns when all are done. The first exception
+    // is rethrown after every rank has finished, so ranks must fail collectively.
+    void run(const std::function<void(LocalComm&)>& body) {
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(size());
+        for (int r = 0; r < size(); r++) {
+            threads.emplace_back([this, r, &body, &errors]() {
+                LocalComm comm(*this, r);
+                try {
+                    body(comm);
+                } catch (...) {
+                    errors[r] = std::current_exception();
+                }
+            });
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        for (std::exception_ptr& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+private:
+    friend class LocalComm;
+
+    // Many senders, one receiver. arrivals changes after every push, so the receiver can
+    // park on it with std::atomic::wait once the ring is empty.
+    struct Mailbox {
+        explicit Mailbox(size_t capacity) : ring(capacity) {}
+        MpmcRing<LocalComm::Message> ring;
+        std::atomic<uint32_t> arrivals{0};
+    };
+
+    std::vector<std::unique_ptr<Mailbox>> boxes;
+    std::barrier<> sync;
+};
+
+inline int LocalComm::size() const {
+    return world.size();
+}
+
+inline void LocalComm::barrier() {
+    auto start_time = std::chrono::steady_clock::now();
+    world.sync.arrive_and_wait();
+    counters.commSeconds += elapsedSince(start_time);
+}
+
+inline void LocalComm::post(int dest, int tag, std::shared_ptr<const std::vector<unsigned char>> payload) {
+    LocalWorld::Mailbox& box = *world.boxes[dest];
+    const size_t bytes = payload->size();
+    Message message{myRank, tag, std::move(payload), std::chrono::steady_clock::now()};
+    while (!box.ring.tryPush(message)) {
+        std::this_thread::yield();
+    }
+    box.arrivals.fetch_add(1, std::memory_order_release);
+    box.arrivals.notify_one();
+    counters.bytesSent += bytes;
+    counters.messages++;
+}
+
+inline bool LocalComm::tryReceive(int source, int tag, Message& message) {
+    auto matches = [source, tag](const Message& m) { return m.source == source && m.tag == tag; };
+    auto it = std::find_if(early.begin(), early.end(), matches);
+    if (it != early.end()) {
+        message = std::move(*it);
+        early.erase(it);
+        return true;
+    }
+    LocalWorld::Mailbox& box = *world.boxes[myRank];
+    Message next;
+    while (box.ring.tryPop(next)) {
+        if (matches(next)) {
+            message = std::move(next);
+            return true;
+        }
+        early.push_back(std::move(next));
+    }
+    return false;
+}
+
+inline LocalComm::Message LocalComm::receive(int source, int tag) {
+    LocalWorld::Mailbox& box = *world.boxes[myRank];
+    Message message;
+    for (;;) {
+        uint32_t seen = box.arrivals.load(std::memory_order_acquire);
+        if (tryReceive(source, tag, message)) {
+            return message;
+        }
+        box.arrivals.wait(seen, std::memory_order_acquire);
+    }
+}
+
+inline void LocalComm::deliver(const Message& message, void* data, size_t bytes) {
+    if (message.payload->size() != bytes) {
+        throw std::runtime_error("LocalComm: message of " + std::to_string(message.payload->size()) +
+                                 " bytes where " + std::to_string(bytes) + " were expected");
+    }
+    std::memcpy(data, message.payload->data(), bytes);
+    counters.bytesReceived += bytes;
+}
+
+// C = A * B over comm.size() ranks with the MPI driver's decomposition: root scatters row
+// blocks of A and gathers those of C, and B is broadcast to all. B goes out in panels of
+// panelRows rows: panel p + 1 is in flight while panel p's slice of every local row is
+// computed (panelRows >= N is the original single broadcast). On root, A and C need
+// ceil(N / size) * size rows; B needs N x N on every rank.
+template <typename T, Communicator Comm>
+void distributedMultiply(Comm& comm, const T* A, T* B, T* C, const size_t N, size_t panelRows) {
+    const int size = comm.size();
+    const size_t rowsPerRank = (N + size - 1) / size;
+    panelRows = std::clamp<size_t>(panelRows, 1, std::max<size_t>(1, N));
+    std::vector<T> localA(rowsPerRank * N), localC(rowsPerRank * N);
+
+    comm.scatter(A, localA.data(), rowsPerRank * N * sizeof(T), 0);
+    const size_t panels = (N + panelRows - 1) / panelRows;
+    std::vector<CommRequest> requests(panels);
+    auto startPanel = [&](size_t p) {
+        const size_t kb = p * panelRows;
+        const size_t kn = std::min(panelRows, N - kb);
+        requests[p] = comm.ibcast(B + kb * N, kn * N * sizeof(T), 0);
+    };
+    if (panels > 0) {
+        startPanel(0);
+    }
+    const RowKernels<T>& kernels = rowKernels<T>();
+    Epilogue<T> accumulate;
+    accumulate.beta = 1;
+    for (size_t p = 0; p < panels; p++) {
+        comm.wait(requests[p]);
+        if (p + 1 < panels) {
+            startPanel(p + 1);
+        }
+        const size_t kb = p * panelRows;
+        const size_t kn = std::min(panelRows, N - kb);
+        comm.compute([&]() {
+            for (size_t i = 0; i < rowsPerRank; i++) {
+                kernels.ikj(localA.data() + i * N + kb, B + kb * N, N, localC.data() + i * N, kn, N,
+                            p == 0 ? nullptr : &accumulate);
+            }
+        });
+    }
+    comm.gather(localC.data(), C, rowsPerRank * N * sizeof(T), 0);
+}
+
+// Every rank's statistics on root, in rank order; collective
+template <Communicator Comm>
+std::vector<CommStats> gatherStats(Comm& comm) {
+    std::vector<CommStats> all(comm.rank() == 0 ? comm.size() : 0);
+    comm.gather(&comm.stats(), all.data(), sizeof(CommStats), 0);
+    return all;
+}
+
+inline void printCommReport(std::ostream& os, const std::vector<CommStats>& ranks) {
+    os << std::setw(6) << "rank" << std::setw(14) << "sent MiB" << std::setw(14) << "received MiB" << std::setw(10)
+       << "messages" << std::setw(12) << "comm s" << std::setw(12) << "compute s" << std::setw(12) << "overlap s"
+       << std::setw(10) << "overlap" << std::endl;
+    for (size_t r = 0; r < ranks.size(); r++) {
+        const CommStats& s = ranks[r];
+        os << std::fixed << std::setprecision(2) << std::setw(6) << r << std::setw(14) << s.bytesSent / 1048576.0
+           << std::setw(14) << s.bytesReceived / 1048576.0 << std::setw(10) << s.messages << std::setprecision(5)
+           << std::setw(12) << s.commSeconds << std::setw(12) << s.computeSeconds << std::setw(12)
+           << s.overlapSeconds << std::setprecision(1) << std::setw(9)
+           << (s.computeSeconds > 0 ? 100 * s.overlapSeconds / s.computeSeconds : 0) << "%" << std::endl;
+    }
+    os << std::defaultfloat << std::setprecision(6);
+}
+
+// Times the single-broadcast and the pipelined product on N x N doubles for rounds rounds,
+// checks the first rows of C on root against a serial product and prints, on root, the
+// per-rank statistics of the last pipelined product. Collective.
+template <Communicator Comm>
+void benchmarkDistributed(Comm& comm, const size_t N, const int rounds, const size_t panelRows, std::ostream& os) {
+    const bool root = comm.rank() == 0;
+    const size_t padded = (N + comm.size() - 1) / comm.size() * comm.size();
+    std::vector<double> A, C, B(N * N);
+    if (root) {
+        A.assign(padded * N, 0.0);
+        C.assign(padded * N, 0.0);
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> distr(0.0, 10.0);
+        for (size_t i = 0; i < N * N; i++) {
+            A[i] = distr(gen);
+            B[i] = distr(gen);
+        }
+    }
+
+    auto measure = [&](size_t panel) {
+        comm.barrier();
+        auto start_time = std::chrono::steady_clock::now();
+        distributedMultiply(comm, A.data(), B.data(), C.data(), N, panel);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    };
+    double singleSum = 0, pipelinedSum = 0;
+    for (int r = 0; r < rounds; r++) {
+        double single = measure(N);
+        comm.stats() = CommStats{};
+        double pipelined = measure(panelRows);
+        singleSum += single;
+        pipelinedSum += pipelined;
+        if (root) {
+            os << "Round " << r + 1 << ":" << std::endl;
+            os << "Execution Time single broadcast: " << single << " seconds" << std::endl;
+            os << "Execution Time pipelined broadcast: " << pipelined << " seconds" << std::endl;
+        }
+    }
+    std::vector<CommStats> stats = gatherStats(comm);
+    if (!root) {
+        return;
+    }
+
+    double maxDiff = 0;
+    for (size_t i = 0; i < std::min<size_t>(N, 16); i++) {
+        for (size_t j = 0; j < N; j++) {
+            double expected = 0;
+            for (size_t k = 0; k < N; k++) {
+                expected += A[i * N + k] * B[k * N + j];
+            }
+            maxDiff = std::max(maxDiff, std::abs(C[i * N + j] - expected) / std::max(1.0, std::abs(expected)));
+        }
+    }
+    os << "Summary: " << std::endl;
+    os << "Average Execution Time for single broadcast: " << singleSum / rounds << " seconds" << std::endl;
+    os << "Average Execution Time for pipelined broadcast: " << pipelinedSum / rounds << " seconds (panels of "
+       << std::min(panelRows, N) << " rows)" << std::endl;
+    os << "Speedup: " << singleSum / pipelinedSum << std::endl;
+    os << "Max relative difference from serial (first rows): " << maxDiff << std::endl;
+    printCommReport(os, stats);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <mpi.h>
+#include "MatrixComm.hpp"
+
+// The Communicator of MatrixComm.hpp over an MPI communicator. MPI does not say how a
+// collective travels, so the byte counts are logical: root is charged (size - 1) * bytes
+// for a scatter or broadcast and every other rank bytes, and a collective is one message.
+// MPI only reports a broadcast complete when it is tested, so a panel is taken to land when
+// the test after a compute() first finds it done: the overlap is an upper bound, and only
+// real if the library progresses transfers in the background (e.g. MPICH_ASYNC_PROGRESS=1).
+class MpiComm : public CommBase {
+public:
+    explicit MpiComm(MPI_Comm comm = MPI_COMM_WORLD) : comm(comm) {
+        MPI_Comm_rank(comm, &myRank);
+        MPI_Comm_size(comm, &ranks);
+    }
+
+    int rank() const { return myRank; }
+    int size() const { return ranks; }
+
+    void barrier() {
+        double start = MPI_Wtime();
+        MPI_Barrier(comm);
+        counters.commSeconds += MPI_Wtime() - start;
+    }
+
+    void scatter(const void* send, void* recv, size_t bytes, int root) {
+        double start = MPI_Wtime();
+        const int count = checkedCount(bytes);
+        MPI_Scatter(send, count, MPI_BYTE, recv, count, MPI_BYTE, root, comm);
+        charge(bytes, root, true);
+        counters.commSeconds += MPI_Wtime() - start;
+    }
+
+    void gather(const void* send, void* recv, size_t bytes, int root) {
+        double start = MPI_Wtime();
+        const int count = checkedCount(bytes);
+        MPI_Gather(send, count, MPI_BYTE, recv, count, MPI_BYTE, root, comm);
+        charge(bytes, root, false);
+        counters.commSeconds += MPI_Wtime() - start;
+    }
+
+    CommRequest ibcast(void* data, size_t bytes, int root) {
+        double start = MPI_Wtime();
+        auto request = std::make_shared<MPI_Request>();
+        MPI_Ibcast(data, checkedCount(bytes), MPI_BYTE, root, comm, request.get());
+        charge(bytes, root, true);
+        counters.commSeconds += MPI_Wtime() - start;
+        return started(
+            [request](std::chrono::steady_clock::time_point& landed) {
+                int flag = 0;
+                MPI_Test(request.get(), &flag, MPI_STATUS_IGNORE);
+                if (flag) {
+                    landed = std::chrono::steady_clock::now();
+                }
+                return flag != 0;
+            },
+            [request]() { MPI_Wait(request.get(), MPI_STATUS_IGNORE); });
+    }
+
+private:
+    static int checkedCount(size_t bytes) {
+        if (bytes > static_cast<size_t>(INT_MAX)) {
+            throw std::runtime_error("MpiComm: " + std::to_string(bytes) + " bytes exceed one MPI message");
+        }
+        return static_cast<int>(bytes);
+    }
+
+    // outward: data flows from root to the others (scatter, broadcast) rather than back
+    void charge(size_t bytes, int root, bool outward) {
+        const uint64_t total = static_cast<uint64_t>(bytes) * (ranks - 1);
+        if (myRank == root) {
+            (outward ? counters.bytesSent : counters.bytesReceived) += total;
+        } else {
+            (outward ? counters.bytesReceived : counters.bytesSent) += bytes;
+        }
+        counters.messages++;
+    }
+
+    MPI_Comm comm;
+    int myRank = 0;
+    int ranks = 1;
+};
@@ -0,0 +1,137 @@
+#include "MatrixCoroutine.hpp"
+
+namespace gemm {
+
+namespace {
+thread_local int currentWorker = 0;
+}
+
+Scheduler::Scheduler(int threads, size_t queueCapacity) : queue(queueCapacity) {
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back([this, t]() { workerLoop(t); });
+    }
+    io = std::thread([this]() { ioLoop(); });
+}
+
+Scheduler::~Scheduler() {
+    stopping.store(true);
+    wakeups.fetch_add(1);
+    wakeups.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+    }
+    ioReady.notify_all();
+    io.join();
+}
+
+int Scheduler::workerIndex() {
+    return currentWorker;
+}
+
+bool Scheduler::tryPost(std::coroutine_handle<> h) {
+    if (!queue.tryPush(h)) {
+        return false;
+    }
+    wake();
+    return true;
+}
+
+void Scheduler::post(std::coroutine_handle<> h) {
+    while (!queue.tryPush(h)) {
+        wake();
+        std::this_thread::yield();
+    }
+    wake();
+}
+
+void Scheduler::submitIo(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        ioJobs.push_back(std::move(job));
+    }
+    ioReady.notify_one();
+}
+
+// Same handshake as ThreadPool::wakeWorkers: after the fence either this thread sees the
+// sleeper, or the sleeper's re-check sees what was published before wake()
+void Scheduler::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+        wakeups.fetch_add(1, std::memory_order_release);
+        wakeups.notify_all();
+    }
+}
+
+// Spin on the queue, then park until wake() unless ready() turns true first; returns true
+// when a coroutine was resumed
+bool Scheduler::parkUnless(const std::function<bool()>& ready) {
+    std::coroutine_handle<> h;
+    for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+        if (queue.tryPop(h)) {
+            h.resume();
+            return true;
+        }
+        if (ready()) {
+            return false;
+        }
+        cpuRelax();
+    }
+
+    uint32_t seen = wakeups.load(std::memory_order_acquire);
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (queue.tryPop(h)) {
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        h.resume();
+        return true;
+    }
+    if (!ready()) {
+        wakeups.wait(seen, std::memory_order_acquire);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Scheduler::runUntil(const CountdownLatch& done) {
+    std::coroutine_handle<> h;
+    while (!done.tryWait()) {
+        if (queue.tryPop(h)) {
+            h.resume();
+        } else {
+            parkUnless([&done]() { return done.tryWait(); });
+        }
+    }
+}
+
+void Scheduler::workerLoop(int index) {
+    currentWorker = index;
+    std::coroutine_handle<> h;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        if (queue.tryPop(h)) {
+            h.resume();
+        } else {
+            parkUnless([this]() { return stopping.load(); });
+        }
+    }
+}
+
+void Scheduler::ioLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(ioMutex);
+            ioReady.wait(lock, [this]() { return stopping.load() || !ioJobs.empty(); });
+            if (ioJobs.empty()) {
+                return;
+            }
+            job = std::move(ioJobs.front());
+            ioJobs.pop_front();
+        }
+        job();
+    }
+}
+
+}  // namespace gemm
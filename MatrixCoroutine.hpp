@@ -0,0 +1,348 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "MatrixLockFree.hpp"
+
+// C++20 coroutine tasks on a fixed set of workers. A tile of work is a coroutine that costs
+// a heap frame, not a thread, so one caller can keep thousands of them in flight:
+//
+//   gemm::Task<void> tile(...) { co_await scheduler.schedule(); ...; }
+//   gemm::sync_wait(scheduler, gemm::when_all(scheduler, std::move(tiles)));
+//
+// Tasks are lazy: nothing runs until a task is awaited. schedule() moves the awaiting
+// coroutine onto the workers' ring, and offload() runs a blocking call (file loading) on the
+// scheduler's I/O thread, so the workers keep computing while it waits.
+namespace gemm {
+
+template <typename T>
+class Task;
+
+class Scheduler {
+public:
+    // threads counts the thread that calls sync_wait, so threads - 1 workers are started
+    explicit Scheduler(int threads, size_t queueCapacity = 1 << 16);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // 1..size()-1 on the scheduler's workers, 0 on any other thread
+    static int workerIndex();
+
+    // co_await schedule(): continue on a worker. When the ring is full the coroutine just
+    // carries on where it is, which throttles whoever is spawning the tiles.
+    auto schedule() {
+        struct Awaiter {
+            Scheduler& scheduler;
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) { return scheduler.tryPost(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // co_await offload(fn): run the blocking fn on the I/O thread, continue on a worker with
+    // its result. Exceptions from fn are rethrown in the coroutine.
+    template <typename F>
+    auto offload(F fn) {
+        using R = decltype(fn());
+        struct Awaiter {
+            Awaiter(Scheduler& scheduler, F fn) : scheduler(scheduler), fn(std::move(fn)) {}
+
+            Scheduler& scheduler;
+            F fn;
+            std::conditional_t<std::is_void_v<R>, bool, std::optional<R>> result{};
+            std::exception_ptr error;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) {
+                scheduler.submitIo([this, h]() {
+                    try {
+                        if constexpr (std::is_void_v<R>) {
+                            fn();
+                        } else {
+                            result.emplace(fn());
+                        }
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    scheduler.post(h);
+                });
+            }
+            R await_resume() {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                if constexpr (!std::is_void_v<R>) {
+                    return std::move(*result);
+                }
+            }
+        };
+        return Awaiter(*this, std::move(fn));
+    }
+
+    // Queue a ready coroutine; false when the ring is full
+    bool tryPost(std::coroutine_handle<> h);
+    // Queue a ready coroutine, waiting for room when the ring is full
+    void post(std::coroutine_handle<> h);
+    void submitIo(std::function<void()> job);
+
+    // Run queued coroutines on this thread until done reaches zero, parking when there is
+    // nothing to run; whoever counts done down must call wake() afterwards
+    void runUntil(const CountdownLatch& done);
+    void wake();
+
+private:
+    void workerLoop(int index);
+    void ioLoop();
+    bool parkUnless(const std::function<bool()>& ready);
+
+    MpmcRing<std::coroutine_handle<>> queue;
+    std::vector<std::thread> workers;
+    std::atomic<uint32_t> wakeups{0};
+    std::atomic<int> sleepers{0};
+    std::atomic<bool> stopping{false};
+
+    std::thread io;
+    std::mutex ioMutex;
+    std::condition_variable ioReady;
+    std::deque<std::function<void()>> ioJobs;
+};
+
+namespace detail {
+
+template <typename P>
+struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    // Symmetric transfer to whoever awaited the task, without growing the stack
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept { return h.promise().continuation; }
+    void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+// Starts at once and frees its own frame; used to drive tasks from ordinary code
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+}  // namespace detail
+
+// Lazily started, single-awaiter coroutine producing a T (or nothing)
+template <typename T = void>
+class Task {
+public:
+    struct promise_type : detail::PromiseBase {
+        std::optional<T> value;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        detail::FinalAwaiter<promise_type> final_suspend() const noexcept { return {}; }
+        template <typename U>
+        void return_value(U&& v) {
+            value.emplace(std::forward<U>(v));
+        }
+    };
+
+    Task() = default;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() {
+                if (handle.promise().error) {
+                    std::rethrow_exception(handle.promise().error);
+                }
+                return std::move(*handle.promise().value);
+            }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    void reset() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <>
+class Task<void> {
+public:
+    struct promise_type : detail::PromiseBase {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        detail::FinalAwaiter<promise_type> final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+    };
+
+    Task() = default;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() { reset(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            void await_resume() const {
+                if (handle.promise().error) {
+                    std::rethrow_exception(handle.promise().error);
+                }
+            }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    void reset() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Awaits every task, each started on a worker, and completes when the last one has; the
+// first exception, if any, is rethrown after all have finished
+inline Task<void> when_all(Scheduler& scheduler, std::vector<Task<void>> tasks) {
+    struct State {
+        std::atomic<size_t> remaining;
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+        std::atomic<bool> failed{false};
+    };
+    State state;
+    state.remaining.store(tasks.size() + 1);
+
+    auto run = [](Scheduler& scheduler, Task<void>& task, State& state) -> detail::Detached {
+        co_await scheduler.schedule();
+        try {
+            co_await std::move(task);
+        } catch (...) {
+            if (!state.failed.exchange(true)) {
+                state.error = std::current_exception();
+            }
+        }
+        if (state.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            state.continuation.resume();
+        }
+    };
+
+    struct Join {
+        Scheduler& scheduler;
+        std::vector<Task<void>>& tasks;
+        State& state;
+        decltype(run)& start;
+        bool await_ready() const noexcept { return tasks.empty(); }
+        bool await_suspend(std::coroutine_handle<> h) {
+            state.continuation = h;
+            for (Task<void>& task : tasks) {
+                start(scheduler, task, state);
+            }
+            // The extra count is this spawner's: whoever brings it to zero resumes h
+            return state.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+        }
+        void await_resume() const noexcept {}
+    };
+    co_await Join{scheduler, tasks, state, run};
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+}
+
+namespace detail {
+
+// A free function rather than a lambda: the frame only holds references to objects that
+// outlive the wait, because the waiter may return as soon as done reaches zero
+template <typename T, typename R>
+Detached completeInto(Scheduler& scheduler, Task<T>& task, R& result, std::exception_ptr& error, CountdownLatch& done) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await std::move(task);
+        } else {
+            result.emplace(co_await std::move(task));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    done.countDown();
+    scheduler.wake();
+}
+
+}  // namespace detail
+
+// Runs task to completion, helping with the scheduler's queue on this thread meanwhile
+template <typename T>
+T sync_wait(Scheduler& scheduler, Task<T> task) {
+    CountdownLatch done(1);
+    std::exception_ptr error;
+    std::conditional_t<std::is_void_v<T>, bool, std::optional<T>> result{};
+    detail::completeInto(scheduler, task, result, error, done);
+    scheduler.runUntil(done);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*result);
+    }
+}
+
+}  // namespace gemm
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters around a kernel via perf_event_open. Counters are opened with
+// inherit set, so worker threads created afterwards (the OpenMP pool) are included;
+// open them before the first parallel region. When the kernel refuses (no PMU in a VM,
+// perf_event_paranoid) the counters read as unavailable and only the timing is reported.
+class PerfCounters {
+public:
+    enum Event { L1D_LOADS, L1D_STORES, LLC_REFERENCES, LLC_MISSES, INSTRUCTIONS, NUM_EVENTS };
+
+    PerfCounters() {
+        const uint64_t l1d = PERF_COUNT_HW_CACHE_L1D;
+        const uint64_t access = static_cast<uint64_t>(PERF_COUNT_HW_CACHE_RESULT_ACCESS) << 16;
+        fds[L1D_LOADS] = open(PERF_TYPE_HW_CACHE, l1d | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_OP_READ) << 8) | access);
+        fds[L1D_STORES] = open(PERF_TYPE_HW_CACHE, l1d | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_OP_WRITE) << 8) | access);
+        fds[LLC_REFERENCES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+        fds[LLC_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds[INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start() {
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            begin[e] = read(e);
+        }
+    }
+
+    void stop() {
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            delta[e] = (fds[e] >= 0) ? read(e) - begin[e] : 0;
+        }
+    }
+
+    // -1 when the event could not be opened
+    int64_t value(Event e) const { return fds[e] >= 0 ? static_cast<int64_t>(delta[e]) : -1; }
+
+    void print(std::ostream& os) const {
+        if (!available()) {
+            os << "counters unavailable";
+            return;
+        }
+        const char* names[NUM_EVENTS] = {"L1D loads", "L1D stores", "LLC refs", "LLC misses", "instructions"};
+        for (int e = 0; e < NUM_EVENTS; e++) {
+            os << (e ? ", " : "") << names[e] << ": ";
+            if (fds[e] >= 0) {
+                os << delta[e];
+            } else {
+                os << "n/a";
+            }
+        }
+    }
+
+private:
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    uint64_t read(int e) const {
+        uint64_t v = 0;
+        if (fds[e] < 0 || ::read(fds[e], &v, sizeof(v)) != sizeof(v)) {
+            return 0;
+        }
+        return v;
+    }
+
+    int fds[NUM_EVENTS];
+    uint64_t begin[NUM_EVENTS] = {};
+    uint64_t delta[NUM_EVENTS] = {};
+};
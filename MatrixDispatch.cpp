@@ -0,0 +1,96 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "MatrixDispatch.hpp"
+
+#ifdef MATRIX_HAVE_ISA_SSE42
+namespace isa_sse42 { extern const RowKernelTable rowKernelTable; }
+#endif
+#ifdef MATRIX_HAVE_ISA_AVX2
+namespace isa_avx2 { extern const RowKernelTable rowKernelTable; }
+#endif
+#ifdef MATRIX_HAVE_ISA_AVX512
+namespace isa_avx512 { extern const RowKernelTable rowKernelTable; }
+#endif
+#ifdef MATRIX_HAVE_ISA_AVX512VNNI
+namespace isa_avx512vnni { extern const RowKernelTable rowKernelTable; }
+#endif
+
+namespace {
+
+struct IsaChoice {
+    const char* name;
+    const RowKernelTable* table;
+};
+
+const RowKernelTable genericTable = makeRowKernelTable();
+
+bool cpuSupports(const char* isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (std::strcmp(isa, "avx512vnni") == 0) {
+        return cpuSupports("avx512") && __builtin_cpu_supports("avx512vnni");
+    } else if (std::strcmp(isa, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+               __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+    } else if (std::strcmp(isa, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    } else if (std::strcmp(isa, "sse42") == 0) {
+        return __builtin_cpu_supports("sse4.2");
+    }
+#endif
+    return std::strcmp(isa, "generic") == 0;
+}
+
+// Widest first
+IsaChoice selectIsa() {
+    const IsaChoice compiled[] = {
+#ifdef MATRIX_HAVE_ISA_AVX512VNNI
+        {"avx512vnni", &isa_avx512vnni::rowKernelTable},
+#endif
+#ifdef MATRIX_HAVE_ISA_AVX512
+        {"avx512", &isa_avx512::rowKernelTable},
+#endif
+#ifdef MATRIX_HAVE_ISA_AVX2
+        {"avx2", &isa_avx2::rowKernelTable},
+#endif
+#ifdef MATRIX_HAVE_ISA_SSE42
+        {"sse42", &isa_sse42::rowKernelTable},
+#endif
+        {"generic", &genericTable},
+    };
+
+    const char* forced = std::getenv("MATRIX_ISA");
+    for (const IsaChoice& choice : compiled) {
+        if (forced && std::strcmp(forced, choice.name) != 0) {
+            continue;
+        }
+        if (cpuSupports(choice.name)) {
+            return choice;
+        }
+    }
+    if (forced) {
+        std::cerr << "MATRIX_ISA=" << forced << " is not built or not supported here, using the default\n";
+        for (const IsaChoice& choice : compiled) {
+            if (cpuSupports(choice.name)) {
+                return choice;
+            }
+        }
+    }
+    return {"generic", &genericTable};
+}
+
+const IsaChoice& activeIsa() {
+    static const IsaChoice choice = selectIsa();
+    return choice;
+}
+
+}  // namespace
+
+const RowKernelTable& activeRowKernelTable() {
+    return *activeIsa().table;
+}
+
+const char* matrixIsaName() {
+    return activeIsa().name;
+}
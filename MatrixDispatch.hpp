@@ -0,0 +1,41 @@
+#pragma once
+
+#include <type_traits>
+#include "MatrixKernels.hpp"
+
+// Row kernels selected for the running CPU. With MATRIX_ISA_DISPATCH (the CMake build)
+// MatrixDispatch.cpp picks the widest compiled variant the CPU supports, overridable
+// with MATRIX_ISA=generic|sse42|avx2|avx512|avx512vnni; otherwise the kernels are the ones this
+// translation unit was compiled with.
+#ifdef MATRIX_ISA_DISPATCH
+const RowKernelTable& activeRowKernelTable();
+const char* matrixIsaName();
+#else
+inline const RowKernelTable& activeRowKernelTable() {
+    static const RowKernelTable table = makeRowKernelTable();
+    return table;
+}
+
+inline const char* matrixIsaName() {
+    return "compile-time";
+}
+#endif
+
+template <typename T>
+const RowKernels<T>& rowKernels() {
+    const RowKernelTable& table = activeRowKernelTable();
+    if constexpr (std::is_same<T, int>::value) {
+        return table.i32;
+    } else if constexpr (std::is_same<T, long long>::value) {
+        return table.i64;
+    } else if constexpr (std::is_same<T, float>::value) {
+        return table.f32;
+    } else {
+        static_assert(std::is_same<T, double>::value, "no row kernels for this element type");
+        return table.f64;
+    }
+}
+
+inline const IntegerKernels& integerKernels() {
+    return activeRowKernelTable().ints;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include "MatrixIsa.hpp"
+
+enum class Activation { None, ReLU, GELU };
+
+// C = act(alpha * A * B + beta * C + bias), applied by the kernels while the result is
+// still in a register (dot-product kernels) or in the L1-resident output row (i-k-j
+// kernels). A null Epilogue pointer means the plain C = A * B overwrite.
+template <typename T>
+struct Epilogue {
+    T alpha = 1;
+    T beta = 0;
+    const T* bias = nullptr;    // one value per output column, may be null
+    Activation act = Activation::None;
+};
+
+inline bool parseActivation(const std::string& name, Activation& act) {
+    if (name == "none") {
+        act = Activation::None;
+    } else if (name == "relu") {
+        act = Activation::ReLU;
+    } else if (name == "gelu") {
+        act = Activation::GELU;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline namespace MATRIX_ISA_NAMESPACE {
+
+template <typename T>
+inline T activate(T v, Activation act) {
+    switch (act) {
+        case Activation::ReLU:
+            return v > T(0) ? v : T(0);
+        case Activation::GELU: {
+            // tanh approximation; integer types go through double
+            double x = static_cast<double>(v);
+            double g = 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * (x + 0.044715 * x * x * x)));
+            if constexpr (std::is_integral<T>::value) {
+                return static_cast<T>(std::llround(g));
+            } else {
+                return static_cast<T>(g);
+            }
+        }
+        case Activation::None:
+            break;
+    }
+    return v;
+}
+
+// Epilogue for one finished dot product; old is the previous C[i][j]
+template <typename T>
+inline T applyEpilogue(const Epilogue<T>& ep, T sum, T old, size_t j) {
+    T v = ep.alpha * sum;
+    if (ep.beta != T(0)) {
+        v += ep.beta * old;
+    }
+    if (ep.bias) {
+        v += ep.bias[j];
+    }
+    return activate(v, ep.act);
+}
+
+// i-k-j kernels accumulate straight into the output row: seed it with beta * C
+// (or zero) before the k loop and scale each A element by alpha...
+template <typename T>
+inline void epilogueRowBegin(const Epilogue<T>* ep, T* __restrict c, const size_t N) {
+    if (ep && ep->beta != T(0)) {
+        for (size_t j = 0; j < N; j++) {
+            c[j] *= ep->beta;
+        }
+    } else {
+        for (size_t j = 0; j < N; j++) {
+            c[j] = T(0);
+        }
+    }
+}
+
+template <typename T>
+inline T epilogueScale(const Epilogue<T>* ep, T a) {
+    return ep ? ep->alpha * a : a;
+}
+
+// ...then add the bias and apply the activation once the row is complete
+template <typename T>
+inline void epilogueRowEnd(const Epilogue<T>* ep, T* __restrict c, const size_t N) {
+    if (!ep) {
+        return;
+    }
+    if (ep->bias) {
+        for (size_t j = 0; j < N; j++) {
+            c[j] += ep->bias[j];
+        }
+    }
+    if (ep->act != Activation::None) {
+        for (size_t j = 0; j < N; j++) {
+            c[j] = activate(c[j], ep->act);
+        }
+    }
+}
+
+}  // namespace MATRIX_ISA_NAMESPACE
@@ -0,0 +1,265 @@
+#include "MatrixGemm.hpp"
+
+#include <cstdlib>
+#include <pthread.h>
+#include <thread>
+
+namespace gemm {
+
+bool parseAlgorithm(const std::string& name, Algorithm& algorithm) {
+    if (name == "auto") {
+        algorithm = Algorithm::Auto;
+    } else if (name == "naive") {
+        algorithm = Algorithm::Naive;
+    } else if (name == "rows" || name == "tuned") {
+        algorithm = Algorithm::Rows;
+    } else if (name == "blocked") {
+        algorithm = Algorithm::Blocked;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseBackend(const std::string& name, Backend& backend) {
+    if (name == "pool") {
+        backend = Backend::Pool;
+    } else if (name == "pthread") {
+        backend = Backend::Pthread;
+    } else if (name == "async") {
+        backend = Backend::Async;
+    } else if (name == "coroutine" || name == "coro") {
+        backend = Backend::Coroutine;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* algorithmName(Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::Naive:
+            return "naive";
+        case Algorithm::Rows:
+            return "rows";
+        case Algorithm::Blocked:
+            return "blocked";
+        case Algorithm::Auto:
+            break;
+    }
+    return "auto";
+}
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Pthread:
+            return "pthread";
+        case Backend::Async:
+            return "async";
+        case Backend::Coroutine:
+            return "coroutine";
+        case Backend::Pool:
+            break;
+    }
+    return "pool";
+}
+
+size_t TuningCache::lookup(const TuneKey& key, const std::function<size_t()>& measure) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = depths.find(key);
+        if (it != depths.end()) {
+            hitCount++;
+            return it->second;
+        }
+    }
+    // Measured outside the lock: two threads may tune the same key, the later answer wins
+    size_t depth = measure();
+    std::lock_guard<std::mutex> lock(mutex);
+    missCount++;
+    depths[key] = depth;
+    return depth;
+}
+
+size_t TuningCache::entries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return depths.size();
+}
+
+size_t TuningCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+size_t TuningCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
+
+Allocator::~Allocator() {
+    for (Block& block : blocks) {
+        std::free(block.ptr);
+    }
+}
+
+void* Allocator::acquire(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Block* best = nullptr;
+    for (Block& block : blocks) {
+        if (!block.inUse && block.bytes >= bytes && (!best || block.bytes < best->bytes)) {
+            best = &block;
+        }
+    }
+    if (best) {
+        best->inUse = true;
+        return best->ptr;
+    }
+    size_t rounded = (bytes + 63) / 64 * 64;
+    void* ptr = std::aligned_alloc(64, rounded);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    blocks.push_back({ptr, rounded, true});
+    return ptr;
+}
+
+void Allocator::release(void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Block& block : blocks) {
+        if (block.ptr == ptr) {
+            block.inUse = false;
+            return;
+        }
+    }
+}
+
+size_t Allocator::bytesReserved() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.bytes;
+    }
+    return total;
+}
+
+static int defaultThreads(int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+Context::Context(int threads) : numThreads(defaultThreads(threads)), workers(numThreads) {}
+
+Scheduler& Context::scheduler() {
+    std::call_once(schedulerStarted, [this]() { coroutines = std::make_unique<Scheduler>(numThreads); });
+    return *coroutines;
+}
+
+namespace {
+
+struct RowRange {
+    const std::function<void(size_t, size_t)>* body;
+    size_t begin;
+    size_t end;
+    int thread;
+    ThreadProfile* profile;
+    double flopsPerRow;
+};
+
+void runTimed(const RowRange& range) {
+    if (!range.profile) {
+        (*range.body)(range.begin, range.end);
+        return;
+    }
+    uint64_t start = readTimestamp();
+    (*range.body)(range.begin, range.end);
+    uint64_t end = readTimestamp();
+    range.profile->record(range.thread, start, end, range.end - range.begin,
+                          range.flopsPerRow * static_cast<double>(range.end - range.begin));
+}
+
+void* runRowRange(void* arg) {
+    runTimed(*static_cast<RowRange*>(arg));
+    return nullptr;
+}
+
+Task<void> rowTile(Scheduler& scheduler, RowRange range) {
+    range.thread = scheduler.workerIndex();
+    runTimed(range);
+    co_return;
+}
+
+}  // namespace
+
+void parallelRows(Context& ctx, Backend backend, int threads, size_t rows,
+                  const std::function<void(size_t, size_t)>& body, ThreadProfile* profile, double flopsPerRow) {
+    if (rows == 0) {
+        return;
+    }
+    threads = std::max(1, threads);
+    if (threads == 1 && backend != Backend::Async && backend != Backend::Coroutine) {
+        runTimed({&body, 0, rows, 0, profile, flopsPerRow});
+        return;
+    }
+
+    if (backend == Backend::Coroutine) {
+        // Tiles of a few rows, far more than there are threads: the scheduler's workers and
+        // the caller take them as they come, so threads only sets the granularity
+        Scheduler& scheduler = ctx.scheduler();
+        if (profile) {
+            profile->resize(scheduler.size());
+        }
+        const size_t tiles = std::min(rows, static_cast<size_t>(threads) * 64);
+        std::vector<Task<void>> tasks;
+        tasks.reserve(tiles);
+        for (size_t t = 0; t < tiles; t++) {
+            tasks.push_back(rowTile(scheduler, {&body, rows * t / tiles, rows * (t + 1) / tiles, 0, profile, flopsPerRow}));
+        }
+        sync_wait(scheduler, when_all(scheduler, std::move(tasks)));
+        return;
+    }
+
+    if (backend == Backend::Pool) {
+        if (profile) {
+            profile->resize(ctx.pool().size());
+        }
+        const size_t chunks = std::min(rows, static_cast<size_t>(threads) * 4);
+        ctx.pool().run(chunks, [&](size_t c) {
+            runTimed({&body, rows * c / chunks, rows * (c + 1) / chunks, ThreadPool::workerIndex(), profile, flopsPerRow});
+        });
+        return;
+    }
+    if (profile) {
+        profile->resize(threads);
+    }
+
+    // The drivers' split: equal parts, the last thread takes the remainder
+    std::vector<RowRange> ranges(threads);
+    const size_t rowsPerThread = rows / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t startRow = t * rowsPerThread;
+        size_t endRow = (t == threads - 1) ? rows : (startRow + rowsPerThread);
+        ranges[t] = {&body, startRow, endRow, t, profile, flopsPerRow};
+    }
+
+    if (backend == Backend::Pthread) {
+        std::vector<pthread_t> handles(threads);
+        for (int t = 0; t < threads; t++) {
+            pthread_create(&handles[t], nullptr, runRowRange, &ranges[t]);
+        }
+        for (int t = 0; t < threads; t++) {
+            pthread_join(handles[t], nullptr);
+        }
+    } else {
+        std::vector<std::future<void*>> futures;
+        for (int t = 0; t < threads; t++) {
+            futures.push_back(std::async(std::launch::async, runRowRange, &ranges[t]));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+}
+
+}  // namespace gemm
@@ -0,0 +1,460 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "MatrixCache.hpp"
+#include "MatrixCoroutine.hpp"
+#include "MatrixDispatch.hpp"
+#include "MatrixEpilogue.hpp"
+#include "MatrixProfile.hpp"
+#include "MatrixThreadPool.hpp"
+
+// Matrix-multiply library behind the benchmark drivers:
+//
+//   gemm::Context ctx(8);
+//   gemm::gemm(ctx, gemm::view(A, M, K), gemm::view(B, K, N), gemm::view(C, M, N), opts);
+//
+// The context owns the worker threads, the tuned panel depths and the packing buffers,
+// so repeated calls pay for none of them again. Views never own memory.
+namespace gemm {
+
+// Row-major matrix in caller-owned storage; row i starts at data + i * ld
+template <typename T>
+struct MatrixView {
+    T* data = nullptr;
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t ld = 0;
+
+    MatrixView() = default;
+    MatrixView(T* data, size_t rows, size_t cols, size_t ld) : data(data), rows(rows), cols(cols), ld(ld) {}
+
+    // A view of T converts to a view of const T
+    template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T> && !std::is_same_v<U, T>>>
+    MatrixView(const MatrixView<U>& other) : data(other.data), rows(other.rows), cols(other.cols), ld(other.ld) {}
+
+    T* row(size_t i) const { return data + i * ld; }
+};
+
+template <typename T>
+MatrixView<T> view(T* data, size_t rows, size_t cols, size_t ld = 0) {
+    return {data, rows, cols, ld ? ld : cols};
+}
+
+// Row tables whose rows share one block with a fixed stride (allocateMatrix, MappedMatrix)
+template <typename T>
+MatrixView<T> view(T** M, size_t rows, size_t cols) {
+    return {M[0], rows, cols, rows > 1 ? static_cast<size_t>(M[1] - M[0]) : cols};
+}
+
+// Trans: B holds the operand transposed, so row j of B is column j of the product's right
+// factor. This is the drivers' RR product.
+enum class Op { None, Trans };
+
+// Naive: the drivers' original triple loops. Rows: one register-accumulating row kernel per
+// output row over the whole of B. Blocked: B is packed into contiguous k panels sized for
+// the cache by the tuning cache, and every panel is swept by all rows before the next.
+// Auto picks Blocked once B no longer fits in a core's L2.
+enum class Algorithm { Auto, Naive, Rows, Blocked };
+
+// Pool: the context's workers. Pthread and Async start one pthread or std::async task per
+// thread for each call, with the drivers' static row split. Coroutine: many small row tiles
+// as coroutine tasks on the context's scheduler (MatrixCoroutine.hpp), joined with when_all.
+enum class Backend { Pool, Pthread, Async, Coroutine };
+
+template <typename T>
+struct Options {
+    Op opB = Op::None;
+    Algorithm algorithm = Algorithm::Auto;
+    Backend backend = Backend::Pool;
+    int threads = 0;                    // 0: the context's thread count
+    const Epilogue<T>* ep = nullptr;    // null: plain C = A * B
+    ThreadProfile* profile = nullptr;   // when set, every thread's spans of work are recorded here
+    ProductCache* cache = nullptr;      // when set, packed B and (without an epilogue) C are reused by content
+};
+
+bool parseAlgorithm(const std::string& name, Algorithm& algorithm);
+bool parseBackend(const std::string& name, Backend& backend);
+const char* algorithmName(Algorithm algorithm);
+const char* backendName(Backend backend);
+
+// Panel depth per problem class: element type and the shape rounded up to powers of two
+struct TuneKey {
+    size_t elemSize;
+    bool integral;
+    size_t M;
+    size_t N;
+    size_t K;
+
+    bool operator<(const TuneKey& other) const {
+        return std::tie(elemSize, integral, M, N, K) <
+               std::tie(other.elemSize, other.integral, other.M, other.N, other.K);
+    }
+};
+
+class TuningCache {
+public:
+    // The stored depth for key; on a miss measure() runs once and its answer is kept
+    size_t lookup(const TuneKey& key, const std::function<size_t()>& measure);
+
+    size_t entries() const;
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    mutable std::mutex mutex;
+    std::map<TuneKey, size_t> depths;
+    size_t hitCount = 0;
+    size_t missCount = 0;
+};
+
+// 64-byte aligned scratch. Released blocks are kept and handed out again to any request
+// they are large enough for, like MatrixPool but untyped and shared between threads.
+class Allocator {
+public:
+    Allocator() = default;
+    ~Allocator();
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+
+    void* acquire(size_t bytes);
+    void release(void* ptr);
+
+    size_t bytesReserved() const;
+
+private:
+    struct Block {
+        void* ptr;
+        size_t bytes;
+        bool inUse;
+    };
+    mutable std::mutex mutex;
+    std::vector<Block> blocks;
+};
+
+class Context {
+public:
+    // threads = 0 uses std::thread::hardware_concurrency()
+    explicit Context(int threads = 0);
+
+    int threads() const { return numThreads; }
+    ThreadPool& pool() { return workers; }
+    // Started on first use, with as many threads as the pool
+    Scheduler& scheduler();
+    TuningCache& tuning() { return cache; }
+    Allocator& allocator() { return scratch; }
+
+private:
+    int numThreads;
+    ThreadPool workers;
+    TuningCache cache;
+    Allocator scratch;
+    std::once_flag schedulerStarted;
+    std::unique_ptr<Scheduler> coroutines;
+};
+
+// body(begin, end) over a partition of [0, rows) on the chosen backend; returns when all
+// parts are done. Pool splits into a few chunks per thread so uneven rows balance out.
+// With a profile, each part is timed and recorded under the index of the thread that ran
+// it; only one profiled call may run at a time.
+void parallelRows(Context& ctx, Backend backend, int threads, size_t rows,
+                  const std::function<void(size_t, size_t)>& body, ThreadProfile* profile = nullptr,
+                  double flopsPerRow = 0);
+
+namespace detail {
+
+inline size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+template <typename T, typename U>
+void checkShapes(const MatrixView<const T>& A, const MatrixView<const T>& B, const MatrixView<U>& C, Op opB) {
+    const size_t bK = opB == Op::None ? B.rows : B.cols;
+    const size_t bN = opB == Op::None ? B.cols : B.rows;
+    if (A.rows != C.rows || A.cols != bK || bN != C.cols) {
+        throw std::runtime_error("gemm: shape mismatch (" + std::to_string(A.rows) + "x" + std::to_string(A.cols) +
+                                 " times " + std::to_string(bK) + "x" + std::to_string(bN) + " into " +
+                                 std::to_string(C.rows) + "x" + std::to_string(C.cols) + ")");
+    }
+}
+
+template <typename T>
+void naiveRows(const MatrixView<const T>& A, const MatrixView<const T>& B, const MatrixView<T>& C, Op opB,
+               const Epilogue<T>* ep, size_t begin, size_t end) {
+    const size_t K = A.cols;
+    for (size_t i = begin; i < end; i++) {
+        const T* a = A.row(i);
+        T* c = C.row(i);
+        for (size_t j = 0; j < C.cols; j++) {
+            T sum = 0;
+            if (opB == Op::None) {
+                for (size_t k = 0; k < K; k++) {
+                    sum += a[k] * B.row(k)[j];
+                }
+            } else {
+                const T* b = B.row(j);
+                for (size_t k = 0; k < K; k++) {
+                    sum += a[k] * b[k];
+                }
+            }
+            c[j] = ep ? applyEpilogue(*ep, sum, c[j], j) : sum;
+        }
+    }
+}
+
+template <typename T>
+void kernelRows(const MatrixView<const T>& A, const MatrixView<const T>& B, const MatrixView<T>& C, Op opB,
+                const Epilogue<T>* ep, size_t begin, size_t end) {
+    const RowKernels<T>& kernels = rowKernels<T>();
+    auto kernel = opB == Op::None ? kernels.ikj : kernels.rr;
+    for (size_t i = begin; i < end; i++) {
+        kernel(A.row(i), B.data, B.ld, C.row(i), A.cols, C.cols, ep);
+    }
+}
+
+// Rows [kb, kb + kn) of the right factor as a dense kn x N block
+template <typename T>
+void packPanel(const MatrixView<const T>& B, Op opB, size_t kb, size_t kn, size_t N, T* panel, size_t begin,
+               size_t end) {
+    if (opB == Op::None) {
+        for (size_t k = begin; k < end; k++) {
+            std::memcpy(panel + k * N, B.row(kb + k), N * sizeof(T));
+        }
+    } else {
+        // begin/end run over output columns here: row j of B becomes column j of the panel
+        for (size_t j = begin; j < end; j++) {
+            const T* b = B.row(j) + kb;
+            for (size_t k = 0; k < kn; k++) {
+                panel[k * N + j] = b[k];
+            }
+        }
+    }
+}
+
+// The panels of one product share the epilogue: the first applies beta to C, later ones
+// add onto it, and only the last adds the bias and applies the activation
+template <typename T>
+const Epilogue<T>* panelEpilogue(const Epilogue<T>* ep, bool first, bool last, Epilogue<T>& storage) {
+    if (first && last) {
+        return ep;
+    }
+    if (first && !ep) {
+        return nullptr;
+    }
+    storage = ep ? *ep : Epilogue<T>{};
+    if (!first) {
+        storage.beta = 1;
+    }
+    if (!last) {
+        storage.bias = nullptr;
+        storage.act = Activation::None;
+    }
+    return &storage;
+}
+
+template <typename T>
+uint64_t hashView(const MatrixView<const T>& M) {
+    return hashRows(M.data, M.rows, M.cols * sizeof(T), M.ld * sizeof(T));
+}
+
+template <typename T>
+CacheKey cacheKey(CacheKind kind, size_t M, size_t K, size_t N, Op opB, Algorithm algorithm, uint64_t hashA,
+                  uint64_t hashB) {
+    return {kind, sizeof(T), std::is_integral<T>::value, M, K, N, static_cast<int>(opB), static_cast<int>(algorithm),
+            hashA, hashB};
+}
+
+// With opts.cache the whole right factor is packed at once, as consecutive K x N panels, and
+// kept under hashB; a repeated B skips packing entirely
+template <typename T>
+void blockedProduct(Context& ctx, const MatrixView<const T>& A, const MatrixView<const T>& B, const MatrixView<T>& C,
+                    const Options<T>& opts, size_t depth, int threads, uint64_t hashB = 0) {
+    const size_t K = A.cols;
+    const size_t N = C.cols;
+    const size_t kc = std::min(depth, K);
+    const RowKernels<T>& kernels = rowKernels<T>();
+    auto packRange = [&](size_t kb, size_t kn, T* dst) {
+        parallelRows(ctx, opts.backend, threads, opts.opB == Op::None ? kn : N, [&](size_t begin, size_t end) {
+            packPanel(B, opts.opB, kb, kn, N, dst, begin, end);
+        });
+    };
+
+    std::shared_ptr<const void> packedB;
+    if (opts.cache) {
+        const CacheKey key = cacheKey<T>(CacheKind::PackedB, 0, K, N, opts.opB, Algorithm::Blocked, 0, hashB);
+        packedB = opts.cache->find(key);
+        if (!packedB) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            std::shared_ptr<void> packing = ProductCache::allocate(K * N * sizeof(T));
+            packRange(0, K, static_cast<T*>(packing.get()));
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+            opts.cache->insert(key, packing, K * N * sizeof(T), elapsed.count());
+            packedB = packing;
+        }
+    }
+    T* panel = packedB ? nullptr : static_cast<T*>(ctx.allocator().acquire(std::max<size_t>(1, kc * N) * sizeof(T)));
+
+    for (size_t kb = 0; kb < K; kb += kc) {
+        const size_t kn = std::min(kc, K - kb);
+        const T* current = panel;
+        if (packedB) {
+            current = static_cast<const T*>(packedB.get()) + kb * N;
+        } else {
+            packRange(kb, kn, panel);
+        }
+
+        Epilogue<T> storage;
+        const Epilogue<T>* ep = panelEpilogue(opts.ep, kb == 0, kb + kn == K, storage);
+        parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                kernels.ikj(A.row(i) + kb, current, N, C.row(i), kn, N, ep);
+            }
+        }, opts.profile, 2.0 * kn * N);
+    }
+    if (panel) {
+        ctx.allocator().release(panel);
+    }
+}
+
+// Time a few panel depths on the first rows of A into scratch, single-threaded so the
+// result reflects one core's cache, and keep the fastest
+template <typename T>
+size_t tunePanelDepth(Context& ctx, const MatrixView<const T>& A, const MatrixView<const T>& B, size_t N, Op opB) {
+    const size_t K = A.cols;
+    if (K <= 64) {
+        return std::max<size_t>(1, K);
+    }
+    const size_t sampleRows = std::min<size_t>(A.rows, 32);
+    T* sample = static_cast<T*>(ctx.allocator().acquire(sampleRows * N * sizeof(T)));
+    MatrixView<const T> subA(A.data, sampleRows, K, A.ld);
+    MatrixView<T> subC(sample, sampleRows, N, N);
+    Options<T> serial;
+    serial.opB = opB;
+    serial.backend = Backend::Pthread;
+
+    std::vector<size_t> candidates;
+    for (size_t depth = 64; depth < K && depth <= 1024; depth *= 2) {
+        candidates.push_back(depth);
+    }
+    candidates.push_back(K);    // one panel: the Rows algorithm plus packing
+
+    size_t best = K;
+    double bestTime = 0;
+    for (size_t depth : candidates) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        blockedProduct(ctx, subA, B, subC, serial, depth, 1);
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+        if (bestTime == 0 || elapsed.count() < bestTime) {
+            bestTime = elapsed.count();
+            best = depth;
+        }
+    }
+    ctx.allocator().release(sample);
+    return best;
+}
+
+}  // namespace detail
+
+inline Algorithm resolveAlgorithm(Algorithm algorithm, size_t K, size_t N, size_t elemSize) {
+    if (algorithm != Algorithm::Auto) {
+        return algorithm;
+    }
+    return K * N * elemSize > (512u << 10) ? Algorithm::Blocked : Algorithm::Rows;
+}
+
+// C = A * B (or A * B^T with opB = Trans), with the epilogue of opts applied on the way out.
+// A is M x K; B is K x N, or N x K when transposed; C is M x N. Throws std::runtime_error
+// when the shapes disagree.
+template <typename T>
+void gemm(Context& ctx, std::type_identity_t<MatrixView<const T>> A, std::type_identity_t<MatrixView<const T>> B,
+          MatrixView<T> C, const Options<T>& opts = {}) {
+    detail::checkShapes(A, B, C, opts.opB);
+    const int threads = opts.threads > 0 ? opts.threads : ctx.threads();
+    if (C.rows == 0 || C.cols == 0) {
+        return;
+    }
+    const Algorithm algorithm = resolveAlgorithm(opts.algorithm, A.cols, C.cols, sizeof(T));
+
+    // A product with an epilogue reads C and the bias as well, so only plain ones are memoized
+    uint64_t hashB = 0;
+    CacheKey resultKey{};
+    const bool memoize = opts.cache && !opts.ep;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (opts.cache) {
+        hashB = detail::hashView(B);
+        if (memoize) {
+            resultKey = detail::cacheKey<T>(CacheKind::Result, C.rows, A.cols, C.cols, opts.opB, algorithm,
+                                            detail::hashView(A), hashB);
+        }
+        auto hashed_time = std::chrono::high_resolution_clock::now();
+        opts.cache->addHashTime(std::chrono::duration<double>(hashed_time - start_time).count());
+        start_time = hashed_time;
+        if (memoize) {
+            if (std::shared_ptr<const void> stored = opts.cache->find(resultKey)) {
+                const T* rows = static_cast<const T*>(stored.get());
+                for (size_t i = 0; i < C.rows; i++) {
+                    std::memcpy(C.row(i), rows + i * C.cols, C.cols * sizeof(T));
+                }
+                return;
+            }
+        }
+    }
+
+    switch (algorithm) {
+        case Algorithm::Naive:
+            parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                detail::naiveRows(A, B, C, opts.opB, opts.ep, begin, end);
+            }, opts.profile, 2.0 * A.cols * C.cols);
+            break;
+        case Algorithm::Blocked: {
+            TuneKey key{sizeof(T), std::is_integral<T>::value, detail::roundUpPow2(C.rows),
+                        detail::roundUpPow2(C.cols), detail::roundUpPow2(A.cols)};
+            size_t depth = ctx.tuning().lookup(key, [&]() {
+                return detail::tunePanelDepth(ctx, A, B, C.cols, opts.opB);
+            });
+            detail::blockedProduct(ctx, A, B, C, opts, depth, threads, hashB);
+            break;
+        }
+        default:
+            parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                detail::kernelRows(A, B, C, opts.opB, opts.ep, begin, end);
+            }, opts.profile, 2.0 * A.cols * C.cols);
+            break;
+    }
+
+    if (memoize) {
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+        std::shared_ptr<void> stored = ProductCache::allocate(C.rows * C.cols * sizeof(T));
+        T* rows = static_cast<T*>(stored.get());
+        for (size_t i = 0; i < C.rows; i++) {
+            std::memcpy(rows + i * C.cols, C.row(i), C.cols * sizeof(T));
+        }
+        opts.cache->insert(resultKey, stored, C.rows * C.cols * sizeof(T), elapsed.count());
+    }
+}
+
+// gemm on a separate thread. The views, the epilogue and its bias must stay valid until
+// the future is ready; the thread joins in the pool's work like any synchronous caller.
+template <typename T>
+std::future<void> gemm_async(Context& ctx, std::type_identity_t<MatrixView<const T>> A,
+                             std::type_identity_t<MatrixView<const T>> B, MatrixView<T> C, const Options<T>& opts = {}) {
+    return std::async(std::launch::async, [&ctx, A, B, C, opts]() { gemm<T>(ctx, A, B, C, opts); });
+}
+
+}  // namespace gemm
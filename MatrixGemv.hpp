@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include "MatrixEpilogue.hpp"
+
+template <typename T>
+struct GemvThreadData {
+    T** A;
+    const T* x;
+    T* y;
+    size_t startRow;
+    size_t endRow;
+    size_t NUM_ARR;     // columns of A, length of x
+    const Epilogue<T>* ep = nullptr;    // y = act(alpha * A * x + beta * y + bias), bias per row
+};
+
+// y = A * x over the thread's rows. GEMV is bound by streaming A, so A is read
+// exactly once: four rows are walked together, each x[j] load feeds four
+// independent accumulators and the sums stay in registers until the row ends.
+template <typename T>
+void* GEMV_Product(void* arg) {
+    auto* data = static_cast<GemvThreadData<T>*>(arg);
+    const T* __restrict x = data->x;
+    T* __restrict y = data->y;
+    const size_t N = data->NUM_ARR;
+
+    size_t i = data->startRow;
+    for (; i + 4 <= data->endRow; i += 4) {
+        const T* __restrict a0 = data->A[i];
+        const T* __restrict a1 = data->A[i + 1];
+        const T* __restrict a2 = data->A[i + 2];
+        const T* __restrict a3 = data->A[i + 3];
+        T sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+        for (size_t j = 0; j < N; j++) {
+            const T xj = x[j];
+            sum0 += a0[j] * xj;
+            sum1 += a1[j] * xj;
+            sum2 += a2[j] * xj;
+            sum3 += a3[j] * xj;
+        }
+        y[i] = data->ep ? applyEpilogue(*data->ep, sum0, y[i], i) : sum0;
+        y[i + 1] = data->ep ? applyEpilogue(*data->ep, sum1, y[i + 1], i + 1) : sum1;
+        y[i + 2] = data->ep ? applyEpilogue(*data->ep, sum2, y[i + 2], i + 2) : sum2;
+        y[i + 3] = data->ep ? applyEpilogue(*data->ep, sum3, y[i + 3], i + 3) : sum3;
+    }
+    for (; i < data->endRow; i++) {
+        const T* __restrict a = data->A[i];
+        T sum = 0;
+        for (size_t j = 0; j < N; j++) {
+            sum += a[j] * x[j];
+        }
+        y[i] = data->ep ? applyEpilogue(*data->ep, sum, y[i], i) : sum;
+    }
+    return nullptr;
+}
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary matrix file: a 4 KiB header followed by the rows, each padded to a
+// multiple of MATRIX_FILE_TILE bytes. The data section starts on a page
+// boundary so it can be mmap'd and used in place as the matrix buffer.
+constexpr char MATRIX_FILE_MAGIC[8] = {'M', 'A', 'T', 'R', 'I', 'X', 'B', '\0'};
+constexpr uint32_t MATRIX_FILE_VERSION = 1;
+constexpr size_t MATRIX_FILE_HEADER_SIZE = 4096;
+constexpr size_t MATRIX_FILE_TILE = 64;
+constexpr size_t MATRIX_IO_BUFFER = 1 << 20;
+
+enum class MatrixDType : uint32_t { Int32 = 1, Int64 = 2, Float32 = 3, Float64 = 4 };
+// Only RowMajor files are written or read; the value 2 (column-major) is reserved
+enum class MatrixLayout : uint32_t { RowMajor = 1, ColMajor = 2 };
+enum class MatrixFormat { Binary, MatrixMarket, CSV };
+
+struct MatrixFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t layout;
+    uint32_t elemSize;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t ld;            // elements per stored row, cols rounded up to the tile
+    uint64_t dataOffset;    // byte offset of the first row
+};
+
+struct MatrixFileInfo {
+    MatrixFormat format;
+    size_t rows;
+    size_t cols;
+};
+
+template <typename T>
+constexpr MatrixDType matrixDType() {
+    if constexpr (std::is_same<T, int>::value) {
+        return MatrixDType::Int32;
+    } else if constexpr (std::is_same<T, long long>::value) {
+        return MatrixDType::Int64;
+    } else if constexpr (std::is_same<T, float>::value) {
+        return MatrixDType::Float32;
+    } else {
+        static_assert(std::is_same<T, double>::value, "unsupported matrix element type");
+        return MatrixDType::Float64;
+    }
+}
+
+inline const char* matrixDTypeName(uint32_t dtype) {
+    switch (static_cast<MatrixDType>(dtype)) {
+        case MatrixDType::Int32: return "int";
+        case MatrixDType::Int64: return "2long";
+        case MatrixDType::Float32: return "float";
+        case MatrixDType::Float64: return "double";
+    }
+    return "unknown";
+}
+
+template <typename T>
+constexpr size_t matrixFileLd(size_t cols) {
+    constexpr size_t perTile = MATRIX_FILE_TILE / sizeof(T);
+    return (cols + perTile - 1) / perTile * perTile;
+}
+
+inline MatrixFormat matrixFormatFromPath(const std::string& path) {
+    auto endsWith = [&path](const char* ext) {
+        size_t n = std::strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (endsWith(".mtx")) {
+        return MatrixFormat::MatrixMarket;
+    } else if (endsWith(".csv")) {
+        return MatrixFormat::CSV;
+    }
+    return MatrixFormat::Binary;
+}
+
+// Read the whole file into memory; the text parsers work on the buffer with from_chars
+inline std::string readWholeFile(const std::string& path) {
+    FILE* fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::string content;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), fp)) > 0) {
+        content.append(buf, n);
+    }
+    std::fclose(fp);
+    return content;
+}
+
+inline MatrixFileHeader readMatrixHeader(const std::string& path) {
+    MatrixFileHeader header;
+    FILE* fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    size_t got = std::fread(&header, sizeof(header), 1, fp);
+    std::fclose(fp);
+    if (got != 1 || std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(path + ": not a binary matrix file");
+    }
+    if (header.version != MATRIX_FILE_VERSION) {
+        throw std::runtime_error(path + ": unsupported matrix file version " + std::to_string(header.version));
+    }
+    if (header.layout != static_cast<uint32_t>(MatrixLayout::RowMajor)) {
+        throw std::runtime_error(path + ": only row-major matrix files are supported");
+    }
+    // rows are read ld apart from dataOffset, so neither may reach outside the file's layout
+    if (header.ld < header.cols) {
+        throw std::runtime_error(path + ": leading dimension " + std::to_string(header.ld) + " is below the column count");
+    }
+    if (header.dataOffset < MATRIX_FILE_HEADER_SIZE) {
+        throw std::runtime_error(path + ": data offset " + std::to_string(header.dataOffset) + " overlaps the header");
+    }
+    return header;
+}
+
+// Skip blank lines and '%' comment lines (MatrixMarket) and return the next data line
+inline bool nextTextLine(const std::string& text, size_t& pos, const char*& begin, const char*& end) {
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = text.size();
+        }
+        begin = text.data() + pos;
+        end = text.data() + eol;
+        pos = eol + 1;
+        while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) {
+            begin++;
+        }
+        if (begin < end && *begin != '%') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parse the next number on the line, skipping separators (space, tab, comma)
+template <typename V>
+bool parseTextValue(const char*& p, const char* end, V& value) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) {
+        p++;
+    }
+    if (p >= end) {
+        return false;
+    }
+    if (*p == '+') {
+        p++;
+    }
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+inline MatrixFileInfo probeMatrixFile(const std::string& path) {
+    MatrixFormat format = matrixFormatFromPath(path);
+    if (format == MatrixFormat::Binary) {
+        MatrixFileHeader header = readMatrixHeader(path);
+        return {format, static_cast<size_t>(header.rows), static_cast<size_t>(header.cols)};
+    }
+
+    std::string text = readWholeFile(path);
+    size_t pos = 0;
+    const char* begin;
+    const char* end;
+    if (format == MatrixFormat::MatrixMarket) {
+        size_t rows = 0, cols = 0;
+        if (!nextTextLine(text, pos, begin, end) || !parseTextValue(begin, end, rows) || !parseTextValue(begin, end, cols)) {
+            throw std::runtime_error(path + ": missing MatrixMarket size line");
+        }
+        return {format, rows, cols};
+    }
+
+    size_t rows = 0, cols = 0;
+    while (nextTextLine(text, pos, begin, end)) {
+        size_t count = 0;
+        double value;
+        while (parseTextValue(begin, end, value)) {
+            count++;
+        }
+        if (rows == 0) {
+            cols = count;
+        } else if (count != cols) {
+            throw std::runtime_error(path + ": ragged CSV row " + std::to_string(rows + 1));
+        }
+        rows++;
+    }
+    return {format, rows, cols};
+}
+
+// Zero-copy view of a binary matrix file. The file is mapped privately so the
+// kernels can take T** without a copy, and the row table points into the mapping.
+template <typename T>
+class MappedMatrix {
+public:
+    explicit MappedMatrix(const std::string& path) {
+        MatrixFileHeader header = readMatrixHeader(path);
+        if (header.dtype != static_cast<uint32_t>(matrixDType<T>()) || header.elemSize != sizeof(T)) {
+            throw std::runtime_error(path + ": stored type is " + matrixDTypeName(header.dtype));
+        }
+        if (header.dataOffset % alignof(T) != 0) {
+            throw std::runtime_error(path + ": data offset " + std::to_string(header.dataOffset) + " is misaligned");
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < header.dataOffset + header.rows * header.ld * sizeof(T)) {
+            ::close(fd);
+            throw std::runtime_error(path + ": file is truncated");
+        }
+        mapSize = static_cast<size_t>(st.st_size);
+        mapping = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error(path + ": mmap failed");
+        }
+        ::madvise(mapping, mapSize, MADV_WILLNEED);
+
+        numRows = header.rows;
+        numCols = header.cols;
+        ld = header.ld;
+        T* data = reinterpret_cast<T*>(static_cast<char*>(mapping) + header.dataOffset);
+        rowPtrs.resize(numRows);
+        for (size_t i = 0; i < numRows; i++) {
+            rowPtrs[i] = data + i * ld;
+        }
+    }
+
+    ~MappedMatrix() {
+        if (mapping != MAP_FAILED) {
+            ::munmap(mapping, mapSize);
+        }
+    }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    T** rows() { return rowPtrs.data(); }
+
+    size_t numRows = 0;
+    size_t numCols = 0;
+    size_t ld = 0;
+
+private:
+    void* mapping = MAP_FAILED;
+    size_t mapSize = 0;
+    std::vector<T*> rowPtrs;
+};
+
+// Buffered stdio writer shared by the binary and text exporters
+class MatrixFileWriter {
+public:
+    explicit MatrixFileWriter(const std::string& path) : path(path), buffer(MATRIX_IO_BUFFER) {
+        fp = std::fopen(path.c_str(), "wb");
+        if (!fp) {
+            throw std::runtime_error("cannot create " + path);
+        }
+        std::setvbuf(fp, buffer.data(), _IOFBF, buffer.size());
+    }
+
+    ~MatrixFileWriter() {
+        if (fp) {
+            std::fclose(fp);
+        }
+    }
+
+    MatrixFileWriter(const MatrixFileWriter&) = delete;
+    MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+    void write(const void* data, size_t bytes) {
+        if (bytes > 0 && std::fwrite(data, 1, bytes, fp) != bytes) {
+            throw std::runtime_error(path + ": write failed");
+        }
+    }
+
+    template <typename V>
+    void writeValue(V value, char sep) {
+        char text[64];
+        auto result = std::to_chars(text, text + sizeof(text) - 1, value);
+        *result.ptr++ = sep;
+        write(text, result.ptr - text);
+    }
+
+    void close() {
+        int rc = std::fclose(fp);
+        fp = nullptr;
+        if (rc != 0) {
+            throw std::runtime_error(path + ": close failed");
+        }
+    }
+
+private:
+    std::string path;
+    std::vector<char> buffer;
+    FILE* fp = nullptr;
+};
+
+template <typename T>
+void writeMatrixBinary(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    MatrixFileHeader header = {};
+    std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.version = MATRIX_FILE_VERSION;
+    header.dtype = static_cast<uint32_t>(matrixDType<T>());
+    header.layout = static_cast<uint32_t>(MatrixLayout::RowMajor);
+    header.elemSize = sizeof(T);
+    header.rows = ROW;
+    header.cols = COL;
+    header.ld = matrixFileLd<T>(COL);
+    header.dataOffset = MATRIX_FILE_HEADER_SIZE;
+
+    std::vector<char> pad(MATRIX_FILE_HEADER_SIZE, 0);
+    std::memcpy(pad.data(), &header, sizeof(header));
+
+    MatrixFileWriter out(path);
+    out.write(pad.data(), MATRIX_FILE_HEADER_SIZE);
+    size_t padBytes = (header.ld - COL) * sizeof(T);
+    for (size_t i = 0; i < ROW; i++) {
+        out.write(M[i], COL * sizeof(T));
+        out.write(pad.data() + MATRIX_FILE_HEADER_SIZE - padBytes, padBytes);
+    }
+    out.close();
+}
+
+// Dense MatrixMarket "array" export; entries are listed column by column per the format
+template <typename T>
+void writeMatrixMarket(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    MatrixFileWriter out(path);
+    const char* field = std::is_integral<T>::value ? "integer" : "real";
+    std::string banner = std::string("%%MatrixMarket matrix array ") + field + " general\n" +
+                         std::to_string(ROW) + " " + std::to_string(COL) + "\n";
+    out.write(banner.data(), banner.size());
+    for (size_t j = 0; j < COL; j++) {
+        for (size_t i = 0; i < ROW; i++) {
+            out.writeValue(M[i][j], '\n');
+        }
+    }
+    out.close();
+}
+
+template <typename T>
+void writeMatrixCSV(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    MatrixFileWriter out(path);
+    for (size_t i = 0; i < ROW; i++) {
+        for (size_t j = 0; j < COL; j++) {
+            out.writeValue(M[i][j], (j + 1 == COL) ? '\n' : ',');
+        }
+    }
+    out.close();
+}
+
+template <typename T>
+void saveMatrix(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    switch (matrixFormatFromPath(path)) {
+        case MatrixFormat::Binary: writeMatrixBinary(path, M, ROW, COL); break;
+        case MatrixFormat::MatrixMarket: writeMatrixMarket(path, M, ROW, COL); break;
+        case MatrixFormat::CSV: writeMatrixCSV(path, M, ROW, COL); break;
+    }
+}
+
+// Load a MatrixMarket file (dense array or sparse coordinate) into an allocated ROW x COL matrix
+template <typename T>
+void readMatrixMarket(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    std::string text = readWholeFile(path);
+    bool coordinate = text.compare(0, 14, "%%MatrixMarket") == 0 && text.find("coordinate") < text.find('\n');
+    bool symmetric = text.compare(0, 14, "%%MatrixMarket") == 0 && text.find("symmetric") < text.find('\n');
+
+    size_t pos = 0;
+    const char* begin;
+    const char* end;
+    size_t rows = 0, cols = 0, nnz = 0;
+    if (!nextTextLine(text, pos, begin, end) || !parseTextValue(begin, end, rows) || !parseTextValue(begin, end, cols)) {
+        throw std::runtime_error(path + ": missing MatrixMarket size line");
+    }
+    if (rows != ROW || cols != COL) {
+        throw std::runtime_error(path + ": expected " + std::to_string(ROW) + "x" + std::to_string(COL));
+    }
+
+    if (coordinate) {
+        parseTextValue(begin, end, nnz);
+        for (size_t i = 0; i < ROW; i++) {
+            std::fill(M[i], M[i] + COL, T(0));
+        }
+        for (size_t e = 0; e < nnz; e++) {
+            size_t r, c;
+            T value = 1;    // "pattern" matrices carry no value column
+            if (!nextTextLine(text, pos, begin, end) || !parseTextValue(begin, end, r) || !parseTextValue(begin, end, c) ||
+                r == 0 || c == 0 || r > ROW || c > COL) {
+                throw std::runtime_error(path + ": bad coordinate entry " + std::to_string(e + 1));
+            }
+            parseTextValue(begin, end, value);
+            M[r - 1][c - 1] = value;
+            if (symmetric) {
+                M[c - 1][r - 1] = value;
+            }
+        }
+        return;
+    }
+
+    for (size_t j = 0; j < COL; j++) {
+        for (size_t i = 0; i < ROW; i++) {
+            while (!parseTextValue(begin, end, M[i][j])) {
+                if (!nextTextLine(text, pos, begin, end)) {
+                    throw std::runtime_error(path + ": too few array entries");
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void readMatrixCSV(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    std::string text = readWholeFile(path);
+    size_t pos = 0;
+    const char* begin;
+    const char* end;
+    for (size_t i = 0; i < ROW; i++) {
+        if (!nextTextLine(text, pos, begin, end)) {
+            throw std::runtime_error(path + ": too few rows");
+        }
+        for (size_t j = 0; j < COL; j++) {
+            if (!parseTextValue(begin, end, M[i][j])) {
+                throw std::runtime_error(path + ": bad value at row " + std::to_string(i + 1));
+            }
+        }
+    }
+}
+
+// Copy a matrix file of any supported format into an allocated ROW x COL matrix
+template <typename T>
+void loadMatrix(const std::string& path, T** M, const size_t ROW, const size_t COL) {
+    switch (matrixFormatFromPath(path)) {
+        case MatrixFormat::Binary: {
+            MappedMatrix<T> mapped(path);
+            if (mapped.numRows != ROW || mapped.numCols != COL) {
+                throw std::runtime_error(path + ": expected " + std::to_string(ROW) + "x" + std::to_string(COL));
+            }
+            for (size_t i = 0; i < ROW; i++) {
+                std::memcpy(M[i], mapped.rows()[i], COL * sizeof(T));
+            }
+            break;
+        }
+        case MatrixFormat::MatrixMarket: readMatrixMarket(path, M, ROW, COL); break;
+        case MatrixFormat::CSV: readMatrixCSV(path, M, ROW, COL); break;
+    }
+}
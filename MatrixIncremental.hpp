@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MatrixGemm.hpp"
+
+// Keeping C = A * B current when only part of an operand changes, instead of paying the
+// full M * K * N again:
+//
+//   gemm::updateRows(ctx, A, B, C, changed);        // rows of A were rewritten in place
+//   gemm::lowRankUpdate(ctx, A, U, V, C);           // B becomes B + U * V^T
+//   gemm::addLowRank(ctx, B, U, V);                 // ...and B itself follows, if still needed
+//
+// Both cost O(N^2 * k) for k changed rows or a rank-k change, so they win while k stays
+// well below N; the incremental mode of the pthread driver measures where the crossover is.
+// Plain products only: options' epilogue and cache are ignored.
+namespace gemm {
+
+namespace detail {
+
+// dst (M.cols x M.rows, dense) = M transposed, serially: the operands here are thin
+template <typename T>
+void transposeThin(const MatrixView<const T>& M, T* dst) {
+    for (size_t r = 0; r < M.rows; r++) {
+        const T* src = M.row(r);
+        for (size_t c = 0; c < M.cols; c++) {
+            dst[c * M.rows + r] = src[c];
+        }
+    }
+}
+
+// C += L * R^T, L being M x k and R being N x k; R is transposed into scratch first so the
+// register-accumulating i-k-j kernel streams each row of C once for all k terms
+template <typename T>
+void addOuterProducts(Context& ctx, const MatrixView<const T>& L, const MatrixView<const T>& R, const MatrixView<T>& C,
+                      const Options<T>& opts) {
+    const size_t k = L.cols;
+    T* Rt = static_cast<T*>(ctx.allocator().acquire(std::max<size_t>(1, k * R.rows) * sizeof(T)));
+    transposeThin(R, Rt);
+    Epilogue<T> accumulate;
+    accumulate.beta = 1;
+    Options<T> inner = opts;
+    inner.opB = Op::None;
+    inner.ep = &accumulate;
+    inner.cache = nullptr;
+    gemm<T>(ctx, L, view<const T>(Rt, k, R.rows), C, inner);
+    ctx.allocator().release(Rt);
+}
+
+}  // namespace detail
+
+// C's rows listed in rows recomputed from the current A and B (opB as in gemm), for
+// |rows| * K * N. The rows are gathered into scratch and multiplied by gemm() with the
+// caller's algorithm and backend, so the cost compares with a full product on the same
+// options. Throws std::runtime_error on a shape mismatch or a row outside C.
+template <typename T>
+void updateRows(Context& ctx, std::type_identity_t<MatrixView<const T>> A, std::type_identity_t<MatrixView<const T>> B,
+                MatrixView<T> C, const std::vector<size_t>& rows, const Options<T>& opts = {}) {
+    detail::checkShapes(A, B, C, opts.opB);
+    for (size_t r : rows) {
+        if (r >= C.rows) {
+            throw std::runtime_error("updateRows: row " + std::to_string(r) + " outside " + std::to_string(C.rows));
+        }
+    }
+    const size_t k = rows.size();
+    if (k == 0 || C.cols == 0) {
+        return;
+    }
+    T* changedA = static_cast<T*>(ctx.allocator().acquire(std::max<size_t>(1, k * A.cols) * sizeof(T)));
+    T* changedC = static_cast<T*>(ctx.allocator().acquire(k * C.cols * sizeof(T)));
+    for (size_t i = 0; i < k; i++) {
+        std::copy(A.row(rows[i]), A.row(rows[i]) + A.cols, changedA + i * A.cols);
+    }
+    Options<T> inner = opts;
+    inner.ep = nullptr;
+    inner.cache = nullptr;
+    gemm<T>(ctx, view<const T>(changedA, k, A.cols), B, view(changedC, k, C.cols), inner);
+    for (size_t i = 0; i < k; i++) {
+        std::copy(changedC + i * C.cols, changedC + (i + 1) * C.cols, C.row(rows[i]));
+    }
+    ctx.allocator().release(changedA);
+    ctx.allocator().release(changedC);
+}
+
+// Given C = A * B, makes C = A * (B + U * V^T) as C += (A * U) * V^T: U is K x k and V is
+// N x k, for M * K * k + M * k * N. B itself is not touched and may be stored either way.
+template <typename T>
+void lowRankUpdate(Context& ctx, std::type_identity_t<MatrixView<const T>> A, std::type_identity_t<MatrixView<const T>> U,
+                   std::type_identity_t<MatrixView<const T>> V, MatrixView<T> C, const Options<T>& opts = {}) {
+    if (U.rows != A.cols || V.rows != C.cols || U.cols != V.cols || A.rows != C.rows) {
+        throw std::runtime_error("lowRankUpdate: shape mismatch (U " + std::to_string(U.rows) + "x" +
+                                 std::to_string(U.cols) + ", V " + std::to_string(V.rows) + "x" +
+                                 std::to_string(V.cols) + " for " + std::to_string(A.rows) + "x" +
+                                 std::to_string(A.cols) + " times " + std::to_string(A.cols) + "x" +
+                                 std::to_string(C.cols) + ")");
+    }
+    const size_t k = U.cols;
+    if (k == 0 || C.rows == 0 || C.cols == 0) {
+        return;
+    }
+    T* W = static_cast<T*>(ctx.allocator().acquire(C.rows * k * sizeof(T)));
+    Options<T> inner = opts;
+    inner.opB = Op::None;
+    inner.ep = nullptr;
+    inner.cache = nullptr;
+    gemm<T>(ctx, A, U, view(W, C.rows, k), inner);
+    detail::addOuterProducts<T>(ctx, view<const T>(W, C.rows, k), V, C, opts);
+    ctx.allocator().release(W);
+}
+
+// B += U * V^T, or B += V * U^T when B is stored transposed (opB = Trans), for K * N * k
+template <typename T>
+void addLowRank(Context& ctx, MatrixView<T> B, std::type_identity_t<MatrixView<const T>> U,
+                std::type_identity_t<MatrixView<const T>> V, Op opB = Op::None, const Options<T>& opts = {}) {
+    const MatrixView<const T>& L = opB == Op::None ? U : V;
+    const MatrixView<const T>& R = opB == Op::None ? V : U;
+    if (L.rows != B.rows || R.rows != B.cols || U.cols != V.cols) {
+        throw std::runtime_error("addLowRank: shape mismatch");
+    }
+    if (U.cols == 0 || B.rows == 0 || B.cols == 0) {
+        return;
+    }
+    detail::addOuterProducts<T>(ctx, L, R, B, opts);
+}
+
+}  // namespace gemm
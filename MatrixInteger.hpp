@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MatrixGemm.hpp"
+
+// Integer products that are exact or say so. The plain int path sums in int, which is
+// undefined once a sum passes 2^31 (values 0-99 get there around N = 220k, and sooner
+// with larger values); integerGemm bounds the sums from the inputs first and picks an
+// accumulator that cannot overflow:
+//
+//   gemm::IntegerReport r = gemm::integerGemm<int16_t>(ctx, A16, B16, C, opts);
+//
+// Inputs are int, int16_t or int8_t and C is int. The narrow types go through dot-product
+// kernels (pmaddwd, or VNNI's vpdpwssd/vpdpbusd in that build), so B is packed transposed
+// first unless it is given with opB = Trans.
+namespace gemm {
+
+// Int32 sums in the element's kernels, Int64 sums exactly; Auto takes Int32 whenever the
+// bound proves it safe
+enum class Accumulator { Auto, Int32, Int64 };
+
+// What happens to a sum that does not fit in C's int: Saturate clamps it to INT_MIN/INT_MAX
+// and counts it; Detect throws std::overflow_error, as does asking for an Int32
+// accumulator that the bound cannot prove safe
+enum class OverflowPolicy { Saturate, Detect };
+
+struct IntegerOptions {
+    Op opB = Op::None;
+    Accumulator accumulator = Accumulator::Auto;
+    OverflowPolicy overflow = OverflowPolicy::Saturate;
+    Backend backend = Backend::Pool;
+    int threads = 0;    // 0: the context's thread count
+};
+
+struct IntegerReport {
+    Accumulator used = Accumulator::Int32;
+    double bound = 0;       // max |a| * max |b| * K: no sum can exceed it in magnitude
+    size_t saturated = 0;   // results clamped to fit C
+};
+
+inline bool parseAccumulator(const std::string& name, Accumulator& accumulator) {
+    if (name == "auto") {
+        accumulator = Accumulator::Auto;
+    } else if (name == "int32") {
+        accumulator = Accumulator::Int32;
+    } else if (name == "int64") {
+        accumulator = Accumulator::Int64;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline bool parseOverflowPolicy(const std::string& name, OverflowPolicy& policy) {
+    if (name == "saturate") {
+        policy = OverflowPolicy::Saturate;
+    } else if (name == "detect") {
+        policy = OverflowPolicy::Detect;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* accumulatorName(Accumulator accumulator) {
+    switch (accumulator) {
+        case Accumulator::Int32:
+            return "int32";
+        case Accumulator::Int64:
+            return "int64";
+        case Accumulator::Auto:
+            break;
+    }
+    return "auto";
+}
+
+namespace detail {
+
+template <typename T>
+long long maxAbs(const MatrixView<const T>& M) {
+    long long largest = 0;
+    for (size_t i = 0; i < M.rows; i++) {
+        const T* row = M.row(i);
+        for (size_t j = 0; j < M.cols; j++) {
+            largest = std::max(largest, std::abs(static_cast<long long>(row[j])));
+        }
+    }
+    return largest;
+}
+
+// dst (M.cols x M.rows, dense) = M transposed
+template <typename T>
+void transposeInto(Context& ctx, Backend backend, int threads, const MatrixView<const T>& M, T* dst) {
+    parallelRows(ctx, backend, threads, M.cols, [&](size_t begin, size_t end) {
+        for (size_t r = 0; r < M.rows; r++) {
+            const T* src = M.row(r);
+            for (size_t c = begin; c < end; c++) {
+                dst[c * M.rows + r] = src[c];
+            }
+        }
+    });
+}
+
+// Exact row sums into int under the overflow policy; returns how many did not fit
+inline size_t storeNarrowed(const long long* sums, int* c, size_t N) {
+    size_t outside = 0;
+    for (size_t j = 0; j < N; j++) {
+        long long v = sums[j];
+        if (v > INT_MAX || v < INT_MIN) {
+            outside++;
+            v = v > INT_MAX ? INT_MAX : INT_MIN;
+        }
+        c[j] = static_cast<int>(v);
+    }
+    return outside;
+}
+
+}  // namespace detail
+
+// C = A * B (or A * B^T with opB = Trans) over integers; see Accumulator and OverflowPolicy
+template <typename T>
+IntegerReport integerGemm(Context& ctx, std::type_identity_t<MatrixView<const T>> A,
+                          std::type_identity_t<MatrixView<const T>> B, MatrixView<int> C, const IntegerOptions& opts = {}) {
+    static_assert(std::is_same_v<T, int> || std::is_same_v<T, int16_t> || std::is_same_v<T, int8_t>,
+                  "integerGemm takes int, int16_t or int8_t elements");
+    detail::checkShapes(A, B, C, opts.opB);
+    const int threads = opts.threads > 0 ? opts.threads : ctx.threads();
+    const size_t K = A.cols;
+    const size_t N = C.cols;
+
+    IntegerReport report;
+    const double productMax = static_cast<double>(detail::maxAbs(A)) * static_cast<double>(detail::maxAbs(B));
+    report.bound = productMax * static_cast<double>(K);
+    const bool int32Safe = report.bound <= INT_MAX;
+    if (opts.accumulator == Accumulator::Int32 && !int32Safe && opts.overflow == OverflowPolicy::Detect) {
+        std::ostringstream message;
+        message << "integerGemm: an int32 accumulator can overflow (bound " << report.bound << ")";
+        throw std::overflow_error(message.str());
+    }
+    // A refused Int32 under Saturate still needs exact sums to saturate correctly
+    report.used = (opts.accumulator == Accumulator::Int64 || !int32Safe) ? Accumulator::Int64 : Accumulator::Int32;
+    if (C.rows == 0 || N == 0) {
+        return report;
+    }
+
+    if constexpr (std::is_same_v<T, int>) {
+        if (report.used == Accumulator::Int32) {
+            // Proven not to overflow, so the ordinary kernels are exact
+            const RowKernels<int>& kernels = rowKernels<int>();
+            auto kernel = opts.opB == Op::None ? kernels.ikj : kernels.rr;
+            parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    kernel(A.row(i), B.data, B.ld, C.row(i), K, N, nullptr);
+                }
+            });
+            return report;
+        }
+    }
+
+    // Exact int64 sums, narrowed per row. The wide int kernel reads B row-major and the
+    // narrow kernels read it transposed, so B is repacked when it comes the other way.
+    constexpr bool dotForm = !std::is_same_v<T, int>;
+    const bool repack = dotForm == (opts.opB == Op::None);
+    const T* packed = B.data;
+    size_t ldb = B.ld;
+    T* scratch = nullptr;
+    if (repack) {
+        scratch = static_cast<T*>(ctx.allocator().acquire(std::max<size_t>(1, K * N) * sizeof(T)));
+        detail::transposeInto(ctx, opts.backend, threads, B, scratch);
+        packed = scratch;
+        ldb = B.rows;
+    }
+
+    // Runs of int32 products in the dot kernels stay below 2^31
+    const size_t chunk = productMax > 0 ? std::max<size_t>(1, static_cast<size_t>(INT_MAX / productMax)) : K + 1;
+    const IntegerKernels& kernels = integerKernels();
+    std::atomic<size_t> outside{0};
+    parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+        std::vector<long long> sums(N);
+        size_t local = 0;
+        for (size_t i = begin; i < end; i++) {
+            if constexpr (std::is_same_v<T, int>) {
+                kernels.ikjWide(A.row(i), packed, ldb, sums.data(), K, N);
+            } else if constexpr (std::is_same_v<T, int16_t>) {
+                kernels.dotI16(A.row(i), packed, ldb, sums.data(), K, N, chunk);
+            } else {
+                kernels.dotI8(A.row(i), packed, ldb, sums.data(), K, N, chunk);
+            }
+            local += detail::storeNarrowed(sums.data(), C.row(i), N);
+        }
+        outside += local;
+    });
+    if (scratch) {
+        ctx.allocator().release(scratch);
+    }
+
+    report.saturated = outside.load();
+    if (report.saturated > 0 && opts.overflow == OverflowPolicy::Detect) {
+        throw std::overflow_error("integerGemm: " + std::to_string(report.saturated) + " results do not fit in int");
+    }
+    return report;
+}
+
+}  // namespace gemm
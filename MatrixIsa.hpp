@@ -0,0 +1,9 @@
+#pragma once
+
+// The kernel headers are compiled once per instruction set for the dispatching build
+// (MatrixKernelsISA.cpp, see CMakeLists.txt). Their inline functions live in a
+// per-ISA inline namespace so the linker cannot fold an AVX-512 instantiation into
+// the generic code path; everything else sees the default namespace.
+#ifndef MATRIX_ISA_NAMESPACE
+#define MATRIX_ISA_NAMESPACE isa_default
+#endif
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "MatrixEpilogue.hpp"
+#include "MatrixIsa.hpp"
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+// Register-accumulating row kernels shared by the drivers. B is reached through
+// brow(k), which returns a pointer to row k, so the same code serves T** and flat storage.
+
+// Function pointers to the row kernels over strided storage (row k of B at B + k * ldb),
+// the form in which each instruction-set build is handed to the dispatcher
+template <typename T>
+struct RowKernels {
+    void (*ikj)(const T* a, const T* B, size_t ldb, T* c, size_t K, size_t N, const Epilogue<T>* ep);
+    void (*rr)(const T* a, const T* B, size_t ldb, T* c, size_t K, size_t N, const Epilogue<T>* ep);
+};
+
+// Integer kernels with exact 64-bit results, behind gemm::integerGemm (MatrixInteger.hpp)
+struct IntegerKernels {
+    // c[0..N) = a[0..K) * B in i-k-j order with int64 accumulators
+    void (*ikjWide)(const int* a, const int* B, size_t ldb, long long* c, size_t K, size_t N);
+    // c[j] = dot(a, row j of B), summed in int32 over runs of at most `chunk` products and
+    // the runs added in int64; chunk is chosen by the caller so a run cannot overflow
+    void (*dotI16)(const int16_t* a, const int16_t* B, size_t ldb, long long* c, size_t K, size_t N, size_t chunk);
+    void (*dotI8)(const int8_t* a, const int8_t* B, size_t ldb, long long* c, size_t K, size_t N, size_t chunk);
+};
+
+struct RowKernelTable {
+    RowKernels<int> i32;
+    RowKernels<long long> i64;
+    RowKernels<float> f32;
+    RowKernels<double> f64;
+    IntegerKernels ints;
+};
+
+inline namespace MATRIX_ISA_NAMESPACE {
+
+// Width of the output strip kept in registers: 256 bytes, i.e. eight AVX2 or four
+// AVX-512 vector registers whatever the element type
+template <typename T>
+constexpr size_t KERNEL_STRIP = 256 / sizeof(T);
+
+// c[0..N) = a[0..K) * B in i-k-j order. Each strip of C is accumulated in a local
+// array the compiler keeps in vector registers across the whole k loop, so C is read
+// once (for beta) and written once instead of being loaded and stored K times.
+template <typename T, typename BRow>
+inline void rowProductIKJ(const T* __restrict a, BRow brow, T* __restrict c, const size_t K, const size_t N,
+                          const Epilogue<T>* ep = nullptr) {
+    constexpr size_t JB = KERNEL_STRIP<T>;
+    size_t jb = 0;
+    for (; jb + JB <= N; jb += JB) {
+        T acc[JB] = {};
+        for (size_t k = 0; k < K; k++) {
+            const T aik = a[k];
+            const T* __restrict b = brow(k) + jb;
+            for (size_t jj = 0; jj < JB; jj++) {
+                acc[jj] += aik * b[jj];
+            }
+        }
+        for (size_t jj = 0; jj < JB; jj++) {
+            c[jb + jj] = ep ? applyEpilogue(*ep, acc[jj], c[jb + jj], jb + jj) : acc[jj];
+        }
+    }
+    if (jb < N) {
+        const size_t jn = N - jb;
+        T acc[JB] = {};
+        for (size_t k = 0; k < K; k++) {
+            const T aik = a[k];
+            const T* __restrict b = brow(k) + jb;
+            for (size_t jj = 0; jj < jn; jj++) {
+                acc[jj] += aik * b[jj];
+            }
+        }
+        for (size_t jj = 0; jj < jn; jj++) {
+            c[jb + jj] = ep ? applyEpilogue(*ep, acc[jj], c[jb + jj], jb + jj) : acc[jj];
+        }
+    }
+}
+
+// c[j] = dot(a, row j of B) for j in [0, N): the row x row product. Four outputs are
+// computed together so each a[k] load feeds four independent register accumulators;
+// the simd reduction lets the compiler vectorise (and reassociate) the sums.
+template <typename T, typename BRow>
+inline void rowProductRR(const T* __restrict a, BRow brow, T* __restrict c, const size_t K, const size_t N,
+                         const Epilogue<T>* ep = nullptr) {
+    size_t j = 0;
+    for (; j + 4 <= N; j += 4) {
+        const T* __restrict b0 = brow(j);
+        const T* __restrict b1 = brow(j + 1);
+        const T* __restrict b2 = brow(j + 2);
+        const T* __restrict b3 = brow(j + 3);
+        T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        #pragma omp simd reduction(+:s0, s1, s2, s3)
+        for (size_t k = 0; k < K; k++) {
+            const T aik = a[k];
+            s0 += aik * b0[k];
+            s1 += aik * b1[k];
+            s2 += aik * b2[k];
+            s3 += aik * b3[k];
+        }
+        const T sums[4] = {s0, s1, s2, s3};
+        for (size_t q = 0; q < 4; q++) {
+            c[j + q] = ep ? applyEpilogue(*ep, sums[q], c[j + q], j + q) : sums[q];
+        }
+    }
+    for (; j < N; j++) {
+        const T* __restrict b = brow(j);
+        T s = 0;
+        #pragma omp simd reduction(+:s)
+        for (size_t k = 0; k < K; k++) {
+            s += a[k] * b[k];
+        }
+        c[j] = ep ? applyEpilogue(*ep, s, c[j], j) : s;
+    }
+}
+
+template <typename T>
+void rowKernelIKJ(const T* a, const T* B, size_t ldb, T* c, size_t K, size_t N, const Epilogue<T>* ep) {
+    rowProductIKJ(a, [B, ldb](size_t k) { return B + k * ldb; }, c, K, N, ep);
+}
+
+template <typename T>
+void rowKernelRR(const T* a, const T* B, size_t ldb, T* c, size_t K, size_t N, const Epilogue<T>* ep) {
+    rowProductRR(a, [B, ldb](size_t j) { return B + j * ldb; }, c, K, N, ep);
+}
+
+// The i-k-j strip kernel for int elements with int64 accumulators. a[k] is widened once
+// and B's elements on use, so each product is a 32x32->64 multiply (pmuldq), which every
+// x86 vector extension has, rather than a full 64-bit one (vpmullq, AVX-512DQ only).
+inline void rowKernelIKJWide(const int* __restrict a, const int* __restrict B, size_t ldb, long long* __restrict c,
+                             size_t K, size_t N) {
+    constexpr size_t JB = KERNEL_STRIP<long long>;
+    size_t jb = 0;
+    for (; jb + JB <= N; jb += JB) {
+        long long acc[JB] = {};
+        for (size_t k = 0; k < K; k++) {
+            const long long aik = a[k];
+            const int* __restrict b = B + k * ldb + jb;
+            for (size_t jj = 0; jj < JB; jj++) {
+                acc[jj] += aik * b[jj];
+            }
+        }
+        for (size_t jj = 0; jj < JB; jj++) {
+            c[jb + jj] = acc[jj];
+        }
+    }
+    if (jb < N) {
+        const size_t jn = N - jb;
+        long long acc[JB] = {};
+        for (size_t k = 0; k < K; k++) {
+            const long long aik = a[k];
+            const int* __restrict b = B + k * ldb + jb;
+            for (size_t jj = 0; jj < jn; jj++) {
+                acc[jj] += aik * b[jj];
+            }
+        }
+        for (size_t jj = 0; jj < jn; jj++) {
+            c[jb + jj] = acc[jj];
+        }
+    }
+}
+
+// Narrow dot product in the shape the compiler maps onto pmaddwd (pairs of 16-bit
+// products summed into 32-bit lanes), or vpdpwssd in an AVX512-VNNI build. No simd
+// pragma here: GCC only recognises the dot-product idiom in the plain loop.
+template <typename T>
+inline long long dotNarrow(const T* __restrict a, const T* __restrict b, size_t K, size_t chunk) {
+    long long sum = 0;
+    for (size_t kb = 0; kb < K; kb += chunk) {
+        const size_t ke = std::min(K, kb + chunk);
+        int32_t s = 0;
+        for (size_t k = kb; k < ke; k++) {
+            s += static_cast<int32_t>(a[k]) * static_cast<int32_t>(b[k]);
+        }
+        sum += s;
+    }
+    return sum;
+}
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+// vpdpbusd multiplies unsigned by signed bytes, four products per 32-bit lane. a + 128 is
+// unsigned, and dot(a + 128, b) - 128 * sum(b) = dot(a, b), with sum(b) from a second
+// vpdpbusd against ones. Runs of 32768 bytes keep every lane and the reduction in int32.
+inline long long dotI8Vnni(const int8_t* a, const int8_t* b, size_t K) {
+    constexpr size_t RUN = 32768;
+    const __m512i flip = _mm512_set1_epi8(static_cast<char>(0x80));
+    const __m512i ones = _mm512_set1_epi8(1);
+    const size_t vecEnd = K / 64 * 64;
+    long long sum = 0;
+    size_t k = 0;
+    while (k < vecEnd) {
+        const size_t runEnd = std::min(vecEnd, k + RUN);
+        __m512i dot = _mm512_setzero_si512();
+        __m512i bsum = _mm512_setzero_si512();
+        for (; k < runEnd; k += 64) {
+            const __m512i va = _mm512_xor_si512(_mm512_loadu_si512(a + k), flip);
+            const __m512i vb = _mm512_loadu_si512(b + k);
+            dot = _mm512_dpbusd_epi32(dot, va, vb);
+            bsum = _mm512_dpbusd_epi32(bsum, ones, vb);
+        }
+        sum += static_cast<long long>(_mm512_reduce_add_epi32(dot)) - 128LL * _mm512_reduce_add_epi32(bsum);
+    }
+    for (; k < K; k++) {
+        sum += static_cast<int32_t>(a[k]) * static_cast<int32_t>(b[k]);
+    }
+    return sum;
+}
+#endif
+
+inline void rowKernelDotI16(const int16_t* a, const int16_t* B, size_t ldb, long long* c, size_t K, size_t N,
+                            size_t chunk) {
+    for (size_t j = 0; j < N; j++) {
+        c[j] = dotNarrow(a, B + j * ldb, K, chunk);
+    }
+}
+
+// int8 products never exceed 2^14, so the VNNI runs are always safe and chunk only
+// matters for the emulated loop
+inline void rowKernelDotI8(const int8_t* a, const int8_t* B, size_t ldb, long long* c, size_t K, size_t N,
+                           size_t chunk) {
+    for (size_t j = 0; j < N; j++) {
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+        (void)chunk;
+        c[j] = dotI8Vnni(a, B + j * ldb, K);
+#else
+        c[j] = dotNarrow(a, B + j * ldb, K, chunk);
+#endif
+    }
+}
+
+inline RowKernelTable makeRowKernelTable() {
+    return {{rowKernelIKJ<int>, rowKernelRR<int>},
+            {rowKernelIKJ<long long>, rowKernelRR<long long>},
+            {rowKernelIKJ<float>, rowKernelRR<float>},
+            {rowKernelIKJ<double>, rowKernelRR<double>},
+            {rowKernelIKJWide, rowKernelDotI16, rowKernelDotI8}};
+}
+
+}  // namespace MATRIX_ISA_NAMESPACE
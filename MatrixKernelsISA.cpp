@@ -0,0 +1,8 @@
+// Compiled once per instruction set with -DMATRIX_ISA_NAMESPACE=isa_<name> and the
+// matching -m flags; exports that build's kernel table to MatrixDispatch.cpp.
+#include "MatrixKernels.hpp"
+
+namespace MATRIX_ISA_NAMESPACE {
+extern const RowKernelTable rowKernelTable;
+const RowKernelTable rowKernelTable = makeRowKernelTable();
+}  // namespace MATRIX_ISA_NAMESPACE
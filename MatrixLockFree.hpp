@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Scheduling primitives for tile-sized tasks: a bounded lock-free MPMC ring to hand the
+// tasks out and a countdown latch to wait for them. Both spin briefly before parking the
+// thread in the kernel (std::atomic::wait), so a busy scheduler never takes a lock and an
+// idle one does not burn a core.
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Spins before a thread parks; a few microseconds, about the cost of a futex round trip
+constexpr int SPIN_LIMIT = 2000;
+
+// Dmitry Vyukov's bounded MPMC queue. Every cell carries a sequence number that says whose
+// turn it is: a producer may fill cell pos when seq == pos, a consumer may empty it when
+// seq == pos + 1. Producers and consumers only contend on their own position counter.
+template <typename T>
+class MpmcRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpmcRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // false when the ring is full
+    bool tryPush(const T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // false when the ring is empty
+    bool tryPop(T& value) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.seq.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<size_t> head{0};
+};
+
+// Completion count for one batch of tasks. countDown() is wait-free; wait() spins while the
+// count is still falling and parks on the counter once it has spun SPIN_LIMIT times. Like
+// std::latch, the last countDown() only touches the counter's address after it reaches
+// zero, so the waiter may destroy the latch as soon as wait() returns.
+class CountdownLatch {
+public:
+    explicit CountdownLatch(std::ptrdiff_t count) : remaining(count) {}
+
+    CountdownLatch(const CountdownLatch&) = delete;
+    CountdownLatch& operator=(const CountdownLatch&) = delete;
+
+    void countDown(std::ptrdiff_t n = 1) {
+        if (remaining.fetch_sub(n, std::memory_order_acq_rel) == n) {
+            remaining.notify_all();
+        }
+    }
+
+    bool tryWait() const { return remaining.load(std::memory_order_acquire) == 0; }
+
+    void wait() const {
+        for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+            if (tryWait()) {
+                return;
+            }
+            cpuRelax();
+        }
+        for (;;) {
+            std::ptrdiff_t seen = remaining.load(std::memory_order_acquire);
+            if (seen == 0) {
+                return;
+            }
+            remaining.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> remaining;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "MatrixGemm.hpp"
+
+// Morton (Z-order) tiled storage: the matrix is cut into tile x tile blocks, each stored
+// row-major, and the blocks are laid out in Z order. Every quadrant at every level of the
+// recursion is then one contiguous range, which is what lets the recursive product below
+// use the caches well at every level without being tuned for any of them.
+template <typename T>
+struct MortonMatrix {
+    size_t n = 0;       // logical size
+    size_t tile = 0;
+    size_t tiles = 0;   // blocks per side, a power of two; padding is zero
+    std::vector<T> data;
+
+    size_t tileElems() const { return tile * tile; }
+};
+
+// Spread the bits of v apart: ...b2 b1 b0 -> ...b2 0 b1 0 b0
+inline size_t mortonSpread(size_t v) {
+    size_t out = 0;
+    for (size_t bit = 0; (v >> bit) != 0; bit++) {
+        out |= ((v >> bit) & 1) << (2 * bit);
+    }
+    return out;
+}
+
+// Z-order position of block (ti, tj); the row bit ranks first, so the quadrants of any
+// block come in the order 00, 01, 10, 11
+inline size_t mortonIndex(size_t ti, size_t tj) {
+    return (mortonSpread(ti) << 1) | mortonSpread(tj);
+}
+
+// Blocks per side must be a power of two. Rather than pad n up to maxTile * 2^k, which
+// can nearly double each side, keep that block count and shrink the tile to just cover n.
+inline size_t mortonTile(const size_t n, const size_t maxTile) {
+    size_t tiles = 1;
+    while (tiles * maxTile < n) {
+        tiles <<= 1;
+    }
+    return std::max<size_t>(1, (n + tiles - 1) / tiles);
+}
+
+template <typename T>
+void resizeMorton(MortonMatrix<T>& M, const size_t n, const size_t maxTile) {
+    const size_t tile = mortonTile(n, maxTile);
+    size_t tiles = 1;
+    while (tiles * tile < n) {
+        tiles <<= 1;
+    }
+    M.n = n;
+    M.tile = tile;
+    M.tiles = tiles;
+    M.data.assign(tiles * tiles * tile * tile, T(0));
+}
+
+template <typename T>
+void packMorton(T** src, const size_t n, const size_t maxTile, MortonMatrix<T>& M) {
+    if (M.n != n || M.tile != mortonTile(n, maxTile)) {
+        resizeMorton(M, n, maxTile);
+    }
+    const size_t tile = M.tile;
+    for (size_t i = 0; i < n; i++) {
+        const size_t ti = i / tile;
+        const size_t ii = i % tile;
+        for (size_t tj = 0; tj * tile < n; tj++) {
+            T* dst = M.data.data() + mortonIndex(ti, tj) * M.tileElems() + ii * tile;
+            const size_t width = std::min(tile, n - tj * tile);
+            std::copy(src[i] + tj * tile, src[i] + tj * tile + width, dst);
+        }
+    }
+}
+
+template <typename T>
+void unpackMorton(const MortonMatrix<T>& M, T** dst) {
+    const size_t tile = M.tile;
+    for (size_t i = 0; i < M.n; i++) {
+        const size_t ti = i / tile;
+        const size_t ii = i % tile;
+        for (size_t tj = 0; tj * tile < M.n; tj++) {
+            const T* src = M.data.data() + mortonIndex(ti, tj) * M.tileElems() + ii * tile;
+            const size_t width = std::min(tile, M.n - tj * tile);
+            std::copy(src, src + width, dst[i] + tj * tile);
+        }
+    }
+}
+
+// C += A * B over one block of tiles x tiles tiles. A, B and C point at the start of their
+// block; quadrant q of a block starts q quarter-blocks further on. The four C quadrants
+// are independent, so down to spawnDepth levels they run as pool tasks; below that, and
+// at the leaves, everything is serial.
+template <typename T>
+void mortonProduct(gemm::Context& ctx, const T* A, const T* B, T* C, const size_t tiles, const size_t tile,
+                   const int spawnDepth, const RowKernels<T>& kernels) {
+    if (tiles == 1) {
+        static const Epilogue<T> accumulate{1, 1, nullptr, Activation::None};
+        for (size_t i = 0; i < tile; i++) {
+            kernels.ikj(A + i * tile, B, tile, C + i * tile, tile, tile, &accumulate);
+        }
+        return;
+    }
+    const size_t half = tiles / 2;
+    const size_t quarter = half * half * tile * tile;
+    auto quadrant = [&](size_t q) {
+        const size_t i = q / 2;
+        const size_t j = q % 2;
+        mortonProduct(ctx, A + (2 * i) * quarter, B + j * quarter, C + q * quarter, half, tile, spawnDepth - 1, kernels);
+        mortonProduct(ctx, A + (2 * i + 1) * quarter, B + (2 + j) * quarter, C + q * quarter, half, tile,
+                      spawnDepth - 1, kernels);
+    };
+    if (spawnDepth > 0) {
+        ctx.pool().run(4, quadrant);
+    } else {
+        for (size_t q = 0; q < 4; q++) {
+            quadrant(q);
+        }
+    }
+}
+
+// C = A * B in Morton layout; A and B must share n and tile. Spawns tasks until there are
+// at least four per thread, so the leaves below balance out on the pool.
+template <typename T>
+void mortonMultiply(gemm::Context& ctx, const MortonMatrix<T>& A, const MortonMatrix<T>& B, MortonMatrix<T>& C,
+                    const int threads) {
+    if (C.n != A.n || C.tile != A.tile) {
+        resizeMorton(C, A.n, A.tile);   // A.tile already covers n, so C gets the same blocks
+    } else {
+        std::fill(C.data.begin(), C.data.end(), T(0));
+    }
+    int spawnDepth = 0;
+    for (size_t tasks = 1, side = A.tiles; tasks < static_cast<size_t>(threads) * 4 && side > 1; side /= 2) {
+        tasks *= 4;
+        spawnDepth++;
+    }
+    if (threads <= 1) {
+        spawnDepth = 0;
+    }
+    mortonProduct(ctx, A.data.data(), B.data.data(), C.data.data(), A.tiles, A.tile, spawnDepth, rowKernels<T>());
+}
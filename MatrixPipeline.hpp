@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Blocking FIFO of at most `capacity` entries between two pipeline stages. After close(),
+// push() fails and pop() drains what is left, then fails.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    bool closed = false;
+};
+
+// Per-item latency (first stage start to last stage end) and per-stage busy time of one run
+struct PipelineReport {
+    size_t items = 0;
+    double seconds = 0;
+    double stageSeconds[3] = {0, 0, 0};
+    std::vector<double> latencies;
+
+    double throughput() const { return seconds > 0 ? items / seconds : 0; }
+
+    // Nearest-rank percentile, p in [0, 100]
+    double percentile(double p) const {
+        if (latencies.empty()) {
+            return 0;
+        }
+        std::vector<double> sorted = latencies;
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(1, rank)) - 1];
+    }
+};
+
+namespace pipeline_detail {
+
+using Clock = std::chrono::high_resolution_clock;
+
+template <typename Slot>
+struct Ticket {
+    Slot* slot;
+    size_t index;
+    Clock::time_point start;
+};
+
+}  // namespace pipeline_detail
+
+// Three-stage stream over `count` items: produce(slot, n) fills a slot with input n,
+// compute(slot, n) multiplies it and consume(slot, n) writes it out. Each stage runs on its
+// own thread and hands slots on through queues of `depth` entries, so while item n is
+// computed, n + 1 is being produced and n - 1 consumed. Slots are recycled once consumed;
+// there must be at least one, and 2 * depth + 3 keep every stage busy. An exception in any
+// stage stops the stream and is rethrown here once all stages have stopped.
+template <typename Slot, typename Produce, typename Compute, typename Consume>
+PipelineReport runPipeline(std::vector<Slot>& slots, const size_t count, const size_t depth, Produce&& produce,
+                           Compute&& compute, Consume&& consume) {
+    using namespace pipeline_detail;
+    BoundedQueue<Slot*> freeSlots(slots.size());
+    BoundedQueue<Ticket<Slot>> produced(depth);
+    BoundedQueue<Ticket<Slot>> computed(depth);
+    for (Slot& slot : slots) {
+        freeSlots.push(&slot);
+    }
+
+    PipelineReport report;
+    report.items = count;
+    report.latencies.resize(count);
+    auto busy = [](Clock::time_point from) { return std::chrono::duration<double>(Clock::now() - from).count(); };
+
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+        freeSlots.close();
+        produced.close();
+        computed.close();
+    };
+
+    auto start_time = Clock::now();
+    std::thread producer([&]() {
+        try {
+            for (size_t n = 0; n < count; n++) {
+                Slot* slot;
+                if (!freeSlots.pop(slot)) {
+                    break;
+                }
+                Clock::time_point start = Clock::now();
+                produce(*slot, n);
+                report.stageSeconds[0] += busy(start);
+                produced.push({slot, n, start});
+            }
+        } catch (...) {
+            fail();
+        }
+        produced.close();
+    });
+    std::thread worker([&]() {
+        try {
+            Ticket<Slot> ticket;
+            while (produced.pop(ticket)) {
+                Clock::time_point start = Clock::now();
+                compute(*ticket.slot, ticket.index);
+                report.stageSeconds[1] += busy(start);
+                computed.push(ticket);
+            }
+        } catch (...) {
+            fail();
+        }
+        computed.close();
+    });
+
+    try {
+        Ticket<Slot> ticket;
+        while (computed.pop(ticket)) {
+            Clock::time_point start = Clock::now();
+            consume(*ticket.slot, ticket.index);
+            report.stageSeconds[2] += busy(start);
+            report.latencies[ticket.index] = busy(ticket.start);
+            freeSlots.push(ticket.slot);
+        }
+    } catch (...) {
+        fail();
+    }
+    producer.join();
+    worker.join();
+    report.seconds = busy(start_time);
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return report;
+}
+
+// The same stages one after another on the calling thread: the reference the pipeline is
+// measured against
+template <typename Slot, typename Produce, typename Compute, typename Consume>
+PipelineReport runSerial(Slot& slot, const size_t count, Produce&& produce, Compute&& compute, Consume&& consume) {
+    using Clock = pipeline_detail::Clock;
+    PipelineReport report;
+    report.items = count;
+    report.latencies.resize(count);
+    auto busy = [](Clock::time_point from) { return std::chrono::duration<double>(Clock::now() - from).count(); };
+
+    auto start_time = Clock::now();
+    for (size_t n = 0; n < count; n++) {
+        Clock::time_point start = Clock::now();
+        produce(slot, n);
+        Clock::time_point mid = Clock::now();
+        compute(slot, n);
+        Clock::time_point late = Clock::now();
+        consume(slot, n);
+        report.stageSeconds[0] += std::chrono::duration<double>(mid - start).count();
+        report.stageSeconds[1] += std::chrono::duration<double>(late - mid).count();
+        report.stageSeconds[2] += busy(late);
+        report.latencies[n] = busy(start);
+    }
+    report.seconds = busy(start_time);
+    return report;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Energy, clock and temperature around a kernel, from sysfs:
+//   - RAPL package energy, /sys/class/powercap/intel-rapl:<n>/energy_uj (often root-only);
+//   - per-core clocks, /sys/devices/system/cpu/cpu<n>/cpufreq/scaling_cur_freq, or the
+//     "cpu MHz" lines of /proc/cpuinfo where there is no cpufreq (VMs);
+//   - the hottest of /sys/class/thermal/thermal_zone<n>/temp and hwmon temp<n>_input.
+// Whatever cannot be read is reported as n/a. settle() replaces a fixed cool-down between
+// rounds: it returns once clocks and temperature have stopped moving.
+struct PowerReading {
+    double seconds = 0;
+    double joules = -1;   // -1 without a readable RAPL counter
+    double ghz = -1;      // mean core clock read before and after the run, -1 without a source
+    double celsius = -1;  // hottest sensor at the end, -1 without one
+};
+
+class PowerMonitor {
+public:
+    PowerMonitor() {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator("/sys/class/powercap", ec)) {
+            const std::string name = entry.path().filename().string();
+            // packages only: intel-rapl:0, not the intel-rapl:0:0 subdomains they contain
+            if (name.rfind("intel-rapl:", 0) == 0 && name.find(':', 11) == std::string::npos) {
+                uint64_t value = 0, range = 0;
+                const std::string file = (entry.path() / "energy_uj").string();
+                if (readNumber(file, value) && readNumber((entry.path() / "max_energy_range_uj").string(), range)) {
+                    energyFiles.push_back(file);
+                    energyRanges.push_back(range);
+                }
+            }
+        }
+        for (const auto& entry : fs::directory_iterator("/sys/devices/system/cpu", ec)) {
+            const std::string file = (entry.path() / "cpufreq" / "scaling_cur_freq").string();
+            uint64_t khz = 0;
+            if (entry.path().filename().string().rfind("cpu", 0) == 0 && readNumber(file, khz)) {
+                freqFiles.push_back(file);
+            }
+        }
+        cpuinfoClock = freqFiles.empty() && cpuinfoGHz() > 0;
+        for (const auto& entry : fs::directory_iterator("/sys/class/thermal", ec)) {
+            addSensor((entry.path() / "temp").string());
+        }
+        for (const auto& entry : fs::directory_iterator("/sys/class/hwmon", ec)) {
+            for (int i = 1; i <= 16; i++) {
+                addSensor((entry.path() / ("temp" + std::to_string(i) + "_input")).string());
+            }
+        }
+    }
+
+    PowerMonitor(const PowerMonitor&) = delete;
+    PowerMonitor& operator=(const PowerMonitor&) = delete;
+
+    bool hasEnergy() const { return !energyFiles.empty(); }
+    bool hasClock() const { return !freqFiles.empty() || cpuinfoClock; }
+    bool hasTemperature() const { return !tempFiles.empty(); }
+
+    void describe(std::ostream& os) const {
+        os << "Power sources: energy " << (hasEnergy() ? std::to_string(energyFiles.size()) + " RAPL package(s)" : "n/a")
+           << ", clock "
+           << (!freqFiles.empty() ? std::to_string(freqFiles.size()) + " cpufreq core(s)"
+                                  : cpuinfoClock ? "/proc/cpuinfo" : "n/a")
+           << ", temperature " << (hasTemperature() ? std::to_string(tempFiles.size()) + " sensor(s)" : "n/a")
+           << std::endl;
+    }
+
+    // Begin a measurement. Nothing is read while the kernel runs: a sampling thread would
+    // take a core from it and show up in inherited perf counters (MatrixCounters.hpp).
+    void start() {
+        energyStart = readEnergy();
+        clockStart = meanGHz();
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    PowerReading stop() {
+        PowerReading reading;
+        reading.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        const std::vector<uint64_t> energyEnd = readEnergy();
+        const double clockEnd = meanGHz();
+        if (hasEnergy() && energyEnd.size() == energyStart.size()) {
+            double microjoules = 0;
+            for (size_t d = 0; d < energyEnd.size(); d++) {
+                // the counter wraps at max_energy_range_uj
+                microjoules += energyEnd[d] >= energyStart[d] ? energyEnd[d] - energyStart[d]
+                                                              : energyEnd[d] + energyRanges[d] - energyStart[d];
+            }
+            reading.joules = microjoules * 1e-6;
+        }
+        reading.ghz = clockStart > 0 && clockEnd > 0 ? (clockStart + clockEnd) / 2 : -1;
+        reading.celsius = hottest();
+        return reading;
+    }
+
+    // Wait, polling every 100 ms, until the mean clock moved by at most 2% and the hottest
+    // sensor by at most 1 C over the last five polls, or maxSeconds have passed. Returns
+    // the seconds waited: 0 at once when neither clock nor temperature can be read.
+    double settle(double maxSeconds = 7.0) {
+        if (!hasClock() && !hasTemperature()) {
+            return 0;
+        }
+        constexpr size_t WINDOW = 5;
+        auto start_time = std::chrono::steady_clock::now();
+        std::vector<double> clocks, temps;
+        for (;;) {
+            clocks.push_back(meanGHz());
+            temps.push_back(hottest());
+            if (clocks.size() > WINDOW) {
+                clocks.erase(clocks.begin());
+                temps.erase(temps.begin());
+            }
+            double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            // a source that cannot be read does not hold the wait up
+            const bool clockSteady = !hasClock() || steady(clocks, 0.02 * clocks.back());
+            const bool tempSteady = !hasTemperature() || steady(temps, 1.0);
+            if ((clocks.size() == WINDOW && clockSteady && tempSteady) || waited >= maxSeconds) {
+                return waited;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+
+    // "Energy: ... J, ... J/GFLOP, effective ... GHz, ... C" for a run of flops operations
+    static void print(std::ostream& os, const PowerReading& reading, double flops) {
+        os << "Energy: ";
+        if (reading.joules >= 0) {
+            os << reading.joules << " J, " << reading.joules / (flops * 1e-9) << " J/GFLOP";
+        } else {
+            os << "n/a";
+        }
+        os << ", effective ";
+        if (reading.ghz > 0) {
+            os << std::fixed << std::setprecision(2) << reading.ghz << std::defaultfloat << std::setprecision(6) << " GHz";
+        } else {
+            os << "n/a GHz";
+        }
+        os << ", " << (reading.seconds > 0 ? flops * 1e-9 / reading.seconds : 0) << " GFLOP/s";
+        if (reading.celsius >= 0) {
+            os << ", " << reading.celsius << " C";
+        }
+    }
+
+private:
+    static bool readNumber(const std::string& file, uint64_t& value) {
+        std::ifstream in(file);
+        return static_cast<bool>(in >> value);
+    }
+
+    // Mean of the "cpu MHz" lines, in GHz; 0 when there are none
+    static double cpuinfoGHz() {
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        double sum = 0;
+        int cores = 0;
+        while (std::getline(in, line)) {
+            if (line.rfind("cpu MHz", 0) == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) {
+                    sum += std::stod(line.substr(colon + 1));
+                    cores++;
+                }
+            }
+        }
+        return cores > 0 ? sum / cores * 1e-3 : 0;
+    }
+
+    void addSensor(const std::string& file) {
+        uint64_t millidegrees = 0;
+        if (readNumber(file, millidegrees)) {
+            tempFiles.push_back(file);
+        }
+    }
+
+    std::vector<uint64_t> readEnergy() const {
+        std::vector<uint64_t> values(energyFiles.size());
+        for (size_t d = 0; d < energyFiles.size(); d++) {
+            readNumber(energyFiles[d], values[d]);
+        }
+        return values;
+    }
+
+    // Mean clock over the cores in GHz, -1 without a source
+    double meanGHz() const {
+        if (freqFiles.empty()) {
+            return cpuinfoClock ? cpuinfoGHz() : -1;
+        }
+        double sum = 0;
+        for (const std::string& file : freqFiles) {
+            uint64_t khz = 0;
+            readNumber(file, khz);
+            sum += khz * 1e-6;
+        }
+        return sum / freqFiles.size();
+    }
+
+    double hottest() const {
+        double celsius = -1;
+        for (const std::string& file : tempFiles) {
+            uint64_t millidegrees = 0;
+            if (readNumber(file, millidegrees)) {
+                celsius = std::max(celsius, millidegrees * 1e-3);
+            }
+        }
+        return celsius;
+    }
+
+    static bool steady(const std::vector<double>& values, double tolerance) {
+        auto [low, high] = std::minmax_element(values.begin(), values.end());
+        return *high - *low <= tolerance;
+    }
+
+    std::vector<std::string> energyFiles;
+    std::vector<uint64_t> energyRanges;
+    std::vector<std::string> freqFiles;
+    bool cpuinfoClock = false;
+    std::vector<std::string> tempFiles;
+
+    std::vector<uint64_t> energyStart;
+    double clockStart = -1;
+    std::chrono::steady_clock::time_point startTime;
+};
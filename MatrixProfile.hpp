@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timestamp counter read by the workers around each piece of work: rdtsc where available
+// (a few nanoseconds, no system call), the steady clock in nanoseconds elsewhere
+inline uint64_t readTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Counter ticks per second, measured once against the steady clock over about 20 ms
+inline double timestampTicksPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double rate = []() {
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tick_start = readTimestamp();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t tick_end = readTimestamp();
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+        return static_cast<double>(tick_end - tick_start) / wall.count();
+    }();
+    return rate;
+#else
+    return 1e9;
+#endif
+}
+
+// One contiguous piece of work done by one thread
+struct ThreadSpan {
+    uint64_t start;
+    uint64_t end;
+    size_t rows;
+    double flops;
+};
+
+// Spans per thread for one parallel run. Slot t is only ever appended to by thread t, so
+// recording takes no lock; the slots are sized up front for the largest thread index.
+class ThreadProfile {
+public:
+    explicit ThreadProfile(int threads = 0) : spans(std::max(1, threads)) {}
+
+    void resize(int threads) {
+        if (threads > static_cast<int>(spans.size())) {
+            spans.resize(threads);
+        }
+    }
+
+    void clear() {
+        for (std::vector<ThreadSpan>& slot : spans) {
+            slot.clear();
+        }
+    }
+
+    void record(int thread, uint64_t start, uint64_t end, size_t rows, double flops) {
+        spans[thread].push_back({start, end, rows, flops});
+    }
+
+    int threads() const { return static_cast<int>(spans.size()); }
+    const std::vector<ThreadSpan>& thread(int t) const { return spans[t]; }
+
+    // Earliest start over all threads, 0 when nothing was recorded
+    uint64_t origin() const {
+        uint64_t first = UINT64_MAX;
+        for (const std::vector<ThreadSpan>& slot : spans) {
+            for (const ThreadSpan& span : slot) {
+                first = std::min(first, span.start);
+            }
+        }
+        return first == UINT64_MAX ? 0 : first;
+    }
+
+    // Per-thread busy time, rows and GFLOP/s; the imbalance ratio (max over mean busy time
+    // of the threads that did any work) and the critical-path thread, the one that finished
+    // last and so set the wall time
+    void printReport(std::ostream& os) const {
+        const double rate = timestampTicksPerSecond();
+        const uint64_t base = origin();
+        double maxBusy = 0, sumBusy = 0;
+        uint64_t lastEnd = 0;
+        int active = 0, critical = -1;
+
+        std::vector<double> busy(spans.size(), 0);
+        for (size_t t = 0; t < spans.size(); t++) {
+            for (const ThreadSpan& span : spans[t]) {
+                busy[t] += (span.end - span.start) / rate;
+                if (span.end > lastEnd) {
+                    lastEnd = span.end;
+                    critical = static_cast<int>(t);
+                }
+            }
+            if (!spans[t].empty()) {
+                active++;
+                sumBusy += busy[t];
+                maxBusy = std::max(maxBusy, busy[t]);
+            }
+        }
+        if (active == 0) {
+            os << "Thread profile: nothing recorded" << std::endl;
+            return;
+        }
+
+        const double meanBusy = sumBusy / active;
+        os << "Thread profile: imbalance max/mean " << (meanBusy > 0 ? maxBusy / meanBusy : 1.0)
+           << ", critical path thread " << critical << " (finished " << (lastEnd - base) / rate << " s after the first start)"
+           << std::endl;
+        os << std::setw(8) << "thread" << std::setw(8) << "spans" << std::setw(10) << "rows" << std::setw(12) << "first s"
+           << std::setw(12) << "last s" << std::setw(12) << "busy s" << std::setw(10) << "GFLOP/s" << std::endl;
+        for (size_t t = 0; t < spans.size(); t++) {
+            if (spans[t].empty()) {
+                continue;
+            }
+            uint64_t first = UINT64_MAX, last = 0;
+            size_t rows = 0;
+            double flops = 0;
+            for (const ThreadSpan& span : spans[t]) {
+                first = std::min(first, span.start);
+                last = std::max(last, span.end);
+                rows += span.rows;
+                flops += span.flops;
+            }
+            os << std::setw(8) << t << std::setw(8) << spans[t].size() << std::setw(10) << rows << std::setw(12)
+               << (first - base) / rate << std::setw(12) << (last - base) / rate << std::setw(12) << busy[t]
+               << std::setw(10) << (busy[t] > 0 ? flops / busy[t] / 1e9 : 0) << std::endl;
+        }
+    }
+private:
+    std::vector<std::vector<ThreadSpan>> spans;
+};
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto): one process per named profile, one
+// track per thread, one complete event per span. Times are microseconds from the earliest
+// span in the file.
+inline void writeChromeTrace(const std::string& path, const std::vector<std::pair<std::string, const ThreadProfile*>>& runs) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("cannot write " + path);
+    }
+    const double usPerTick = 1e6 / timestampTicksPerSecond();
+    uint64_t base = UINT64_MAX;
+    for (const auto& run : runs) {
+        for (int t = 0; t < run.second->threads(); t++) {
+            for (const ThreadSpan& span : run.second->thread(t)) {
+                base = std::min(base, span.start);
+            }
+        }
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+    for (size_t pid = 0; pid < runs.size(); pid++) {
+        separator();
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"" << runs[pid].first
+            << "\"}}";
+        const ThreadProfile& profile = *runs[pid].second;
+        for (int t = 0; t < profile.threads(); t++) {
+            for (const ThreadSpan& span : profile.thread(t)) {
+                separator();
+                out << std::fixed << std::setprecision(3) << "{\"name\":\"" << span.rows << " rows\",\"ph\":\"X\",\"pid\":"
+                    << pid << ",\"tid\":" << t << ",\"ts\":" << (span.start - base) * usPerTick
+                    << ",\"dur\":" << (span.end - span.start) * usPerTick << ",\"args\":{\"rows\":" << span.rows
+                    << ",\"flops\":" << span.flops << "}}";
+            }
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Strong scaling: N is fixed and the workers grow, so ideally the time falls as 1/p.
+// Weak scaling: N^3/p is held constant, so every worker keeps the same share of the flops
+// and ideally the time stays flat.
+enum class ScalingKind { Strong, Weak };
+
+inline bool parseScalingKind(const std::string& name, ScalingKind& kind) {
+    if (name == "strong") {
+        kind = ScalingKind::Strong;
+    } else if (name == "weak") {
+        kind = ScalingKind::Weak;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// One measured configuration: average seconds of one product of size n on the given workers
+struct ScalingPoint {
+    int workers;
+    size_t n;
+    double seconds;
+};
+
+// 1, 2, 4, ... up to maxWorkers, with maxWorkers itself always last
+inline std::vector<int> scalingWorkers(int maxWorkers) {
+    std::vector<int> counts;
+    for (int p = 1; p < maxWorkers; p *= 2) {
+        counts.push_back(p);
+    }
+    counts.push_back(std::max(1, maxWorkers));
+    return counts;
+}
+
+// Matrix size for p workers: n for strong scaling, n * cbrt(p) for weak scaling
+inline size_t scalingSize(ScalingKind kind, size_t n, int workers) {
+    if (kind == ScalingKind::Strong) {
+        return n;
+    }
+    return static_cast<size_t>(std::llround(static_cast<double>(n) * std::cbrt(static_cast<double>(workers))));
+}
+
+// Times measure(workers, n) over the worker counts; each point is the average of `rounds`
+// calls after one untimed warm-up call, so one-off costs (thread start-up, tuning, first
+// touch) stay out of the table
+inline std::vector<ScalingPoint> runScaling(ScalingKind kind, size_t n, int maxWorkers, int rounds,
+                                            const std::function<double(int, size_t)>& measure) {
+    std::vector<ScalingPoint> points;
+    for (int p : scalingWorkers(maxWorkers)) {
+        const size_t size = scalingSize(kind, n, p);
+        measure(p, size);
+        double total = 0;
+        for (int r = 0; r < rounds; r++) {
+            total += measure(p, size);
+        }
+        points.push_back({p, size, total / std::max(1, rounds)});
+    }
+    return points;
+}
+
+// Speedup is the rate of flops against the one-worker point (for weak scaling this is the
+// scaled speedup, since the problem grows with p); efficiency is speedup / p; Karp-Flatt is
+// the experimentally determined serial fraction (1/S - 1/p) / (1 - 1/p), which should stay
+// flat if the loss comes from serial work and grow with p if it comes from overhead.
+inline void printScalingTable(std::ostream& os, const std::string& label, ScalingKind kind,
+                              const std::vector<ScalingPoint>& points) {
+    if (points.empty()) {
+        return;
+    }
+    os << (kind == ScalingKind::Strong ? "Strong" : "Weak") << " scaling, " << label << ":" << std::endl;
+    os << std::setw(8) << "workers" << std::setw(8) << "N" << std::setw(14) << "seconds" << std::setw(10) << "speedup"
+       << std::setw(12) << "efficiency" << std::setw(13) << "karp-flatt" << std::endl;
+
+    // the first point is the one-worker run
+    const double baseRate = std::pow(static_cast<double>(points.front().n), 3) / points.front().seconds;
+    for (const ScalingPoint& point : points) {
+        const double speedup = std::pow(static_cast<double>(point.n), 3) / point.seconds / baseRate;
+        const double efficiency = speedup / point.workers;
+        os << std::setw(8) << point.workers << std::setw(8) << point.n << std::setw(14) << point.seconds << std::setw(10)
+           << speedup << std::setw(12) << efficiency;
+        if (point.workers > 1) {
+            const double p = point.workers;
+            os << std::setw(13) << (1.0 / speedup - 1.0 / p) / (1.0 - 1.0 / p);
+        } else {
+            os << std::setw(13) << "-";
+        }
+        os << std::endl;
+    }
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "MatrixGemm.hpp"
+
+// The row-split, blocked machinery of gemm::gemm over any semiring (S, add, mul, zero):
+//
+//   gemm::semiringGemm<gemm::MinPlus<float>>(ctx, dist, dist, next, opts);    // one relaxation step
+//
+// and complex products through three or four real gemm calls (complexGemm).
+namespace gemm {
+
+// add is associative and commutative with identity zero(); mul distributes over add.
+// skipsZero: mul(zero, x) == zero, so a zero a[k] contributes nothing and the kernels
+// skip row k of B entirely, which is what makes sparse graphs cheap.
+template <typename S>
+concept Semiring = requires(typename S::value_type a, typename S::value_type b) {
+    { S::zero() } -> std::same_as<typename S::value_type>;
+    { S::add(a, b) } -> std::same_as<typename S::value_type>;
+    { S::mul(a, b) } -> std::same_as<typename S::value_type>;
+    { S::skipsZero } -> std::convertible_to<bool>;
+};
+
+// Ordinary arithmetic; for real types gemm::gemm is the faster way to the same result
+template <typename T>
+struct PlusTimes {
+    using value_type = T;
+    static constexpr bool skipsZero = false;
+    static T zero() { return T(0); }
+    static T add(T a, T b) { return a + b; }
+    static T mul(T a, T b) { return a * b; }
+};
+
+// Tropical (shortest paths): C[i][j] = min_k A[i][k] + B[k][j]. Missing edges are
+// zero() = infinity, or the largest value for integers, which absorbs any addition.
+template <typename T>
+struct MinPlus {
+    using value_type = T;
+    static constexpr bool skipsZero = true;
+    static T zero() {
+        if constexpr (std::numeric_limits<T>::has_infinity) {
+            return std::numeric_limits<T>::infinity();
+        } else {
+            return std::numeric_limits<T>::max();
+        }
+    }
+    static T add(T a, T b) { return std::min(a, b); }
+    static T mul(T a, T b) {
+        if constexpr (std::numeric_limits<T>::has_infinity) {
+            return a + b;
+        } else {
+            return (a == zero() || b == zero()) ? zero() : a + b;
+        }
+    }
+};
+
+// Most reliable path over non-negative weights (probabilities): C[i][j] = max_k A[i][k] * B[k][j]
+template <typename T>
+struct MaxTimes {
+    using value_type = T;
+    static constexpr bool skipsZero = true;
+    static T zero() { return T(0); }
+    static T add(T a, T b) { return std::max(a, b); }
+    static T mul(T a, T b) { return a * b; }
+};
+
+// Boolean reachability over 0/1 bytes: C[i][j] = OR_k A[i][k] AND B[k][j]. With the
+// skip a set a[k] ORs row k of B into C's row, a byte-wise vector OR.
+struct OrAnd {
+    using value_type = uint8_t;
+    static constexpr bool skipsZero = true;
+    static uint8_t zero() { return 0; }
+    static uint8_t add(uint8_t a, uint8_t b) { return a | b; }
+    static uint8_t mul(uint8_t a, uint8_t b) { return a & b; }
+};
+
+struct SemiringOptions {
+    Algorithm algorithm = Algorithm::Auto;  // Naive, Rows or Blocked, as for gemm
+    Backend backend = Backend::Pool;
+    int threads = 0;    // 0: the context's thread count
+};
+
+namespace detail {
+
+// Columns [jb, jb + jn) of c = a * B over S, kept in registers across the k loop like
+// rowProductIKJ; accumulate continues from c instead of starting at zero
+template <typename S, size_t JB>
+inline void semiringStrip(const typename S::value_type* __restrict a, const typename S::value_type* __restrict B,
+                          size_t ldb, typename S::value_type* __restrict c, size_t K, size_t jb, size_t jn,
+                          bool accumulate) {
+    using V = typename S::value_type;
+    V acc[JB];
+    for (size_t jj = 0; jj < jn; jj++) {
+        acc[jj] = accumulate ? c[jb + jj] : S::zero();
+    }
+    for (size_t k = 0; k < K; k++) {
+        const V aik = a[k];
+        if constexpr (S::skipsZero) {
+            if (aik == S::zero()) {
+                continue;
+            }
+        }
+        const V* __restrict b = B + k * ldb + jb;
+        for (size_t jj = 0; jj < jn; jj++) {
+            acc[jj] = S::add(acc[jj], S::mul(aik, b[jj]));
+        }
+    }
+    for (size_t jj = 0; jj < jn; jj++) {
+        c[jb + jj] = acc[jj];
+    }
+}
+
+template <typename S>
+inline void semiringRow(const typename S::value_type* a, const typename S::value_type* B, size_t ldb,
+                        typename S::value_type* c, size_t K, size_t N, bool accumulate) {
+    constexpr size_t JB = KERNEL_STRIP<typename S::value_type>;
+    size_t jb = 0;
+    for (; jb + JB <= N; jb += JB) {
+        semiringStrip<S, JB>(a, B, ldb, c, K, jb, JB, accumulate);
+    }
+    if (jb < N) {
+        semiringStrip<S, JB>(a, B, ldb, c, K, jb, N - jb, accumulate);
+    }
+}
+
+// The drivers' original triple loop over S, the reference for the others
+template <typename S>
+void semiringNaiveRows(const MatrixView<const typename S::value_type>& A, const MatrixView<const typename S::value_type>& B,
+                       const MatrixView<typename S::value_type>& C, size_t begin, size_t end) {
+    using V = typename S::value_type;
+    for (size_t i = begin; i < end; i++) {
+        for (size_t j = 0; j < C.cols; j++) {
+            V sum = S::zero();
+            for (size_t k = 0; k < A.cols; k++) {
+                sum = S::add(sum, S::mul(A.row(i)[k], B.row(k)[j]));
+            }
+            C.row(i)[j] = sum;
+        }
+    }
+}
+
+}  // namespace detail
+
+// C = A (+) B over S, A M x K, B K x N. Blocked packs B into panels of about 256 KiB and
+// sweeps every panel with all rows before the next, continuing each row from the
+// previous panel's result.
+template <Semiring S>
+void semiringGemm(Context& ctx, std::type_identity_t<MatrixView<const typename S::value_type>> A,
+                  std::type_identity_t<MatrixView<const typename S::value_type>> B, MatrixView<typename S::value_type> C,
+                  const SemiringOptions& opts = {}) {
+    using V = typename S::value_type;
+    detail::checkShapes(A, B, C, Op::None);
+    const int threads = opts.threads > 0 ? opts.threads : ctx.threads();
+    const size_t K = A.cols;
+    const size_t N = C.cols;
+    if (C.rows == 0 || N == 0) {
+        return;
+    }
+
+    // with K = 0 only the Rows path writes C (all zero())
+    const Algorithm algorithm = K == 0 ? Algorithm::Rows : resolveAlgorithm(opts.algorithm, K, N, sizeof(V));
+    switch (algorithm) {
+        case Algorithm::Naive:
+            parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                detail::semiringNaiveRows<S>(A, B, C, begin, end);
+            });
+            break;
+        case Algorithm::Blocked: {
+            const size_t kc = std::min(K, std::max<size_t>(16, (256u << 10) / (N * sizeof(V))));
+            V* panel = static_cast<V*>(ctx.allocator().acquire(std::max<size_t>(1, kc * N) * sizeof(V)));
+            for (size_t kb = 0; kb < K; kb += kc) {
+                const size_t kn = std::min(kc, K - kb);
+                parallelRows(ctx, opts.backend, threads, kn, [&](size_t begin, size_t end) {
+                    detail::packPanel(B, Op::None, kb, kn, N, panel, begin, end);
+                });
+                parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        detail::semiringRow<S>(A.row(i) + kb, panel, N, C.row(i), kn, N, kb > 0);
+                    }
+                });
+            }
+            ctx.allocator().release(panel);
+            break;
+        }
+        default:
+            parallelRows(ctx, opts.backend, threads, C.rows, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    detail::semiringRow<S>(A.row(i), B.data, B.ld, C.row(i), K, N, false);
+                }
+            });
+            break;
+    }
+}
+
+// Direct: the semiring kernel on std::complex (each product through the library's
+// complex multiply). FourM: Cr = Ar Br - Ai Bi and Ci = Ar Bi + Ai Br as four real gemm
+// calls, the second of each pair folded in through the epilogue. ThreeM: Karatsuba's
+// T1 = Ar Br, T2 = Ai Bi, T3 = (Ar + Ai)(Br + Bi), Cr = T1 - T2, Ci = T3 - T1 - T2, a
+// quarter fewer multiplies for slightly larger rounding error in Ci.
+enum class ComplexMethod { Direct, FourM, ThreeM };
+
+inline bool parseComplexMethod(const std::string& name, ComplexMethod& method) {
+    if (name == "direct") {
+        method = ComplexMethod::Direct;
+    } else if (name == "4m") {
+        method = ComplexMethod::FourM;
+    } else if (name == "3m") {
+        method = ComplexMethod::ThreeM;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline const char* complexMethodName(ComplexMethod method) {
+    switch (method) {
+        case ComplexMethod::Direct:
+            return "direct";
+        case ComplexMethod::FourM:
+            return "4m";
+        case ComplexMethod::ThreeM:
+            break;
+    }
+    return "3m";
+}
+
+struct ComplexOptions {
+    ComplexMethod method = ComplexMethod::ThreeM;
+    Algorithm algorithm = Algorithm::Auto;  // for the real products of 3M/4M
+    Backend backend = Backend::Pool;
+    int threads = 0;    // 0: the context's thread count
+};
+
+template <typename T>
+void complexGemm(Context& ctx, std::type_identity_t<MatrixView<const std::complex<T>>> A,
+                 std::type_identity_t<MatrixView<const std::complex<T>>> B, MatrixView<std::complex<T>> C,
+                 const ComplexOptions& opts = {}) {
+    static_assert(std::is_floating_point_v<T>, "complexGemm takes std::complex<float> or std::complex<double>");
+    detail::checkShapes(A, B, C, Op::None);
+    const int threads = opts.threads > 0 ? opts.threads : ctx.threads();
+    if (opts.method == ComplexMethod::Direct) {
+        SemiringOptions direct;
+        direct.algorithm = opts.algorithm;
+        direct.backend = opts.backend;
+        direct.threads = threads;
+        semiringGemm<PlusTimes<std::complex<T>>>(ctx, A, B, C, direct);
+        return;
+    }
+
+    const size_t M = C.rows, N = C.cols, K = A.cols;
+    if (M == 0 || N == 0) {
+        return;
+    }
+    // Real and imaginary planes; 3M also needs the sums of A and B and a third product
+    const bool three = opts.method == ComplexMethod::ThreeM;
+    const size_t planeBytes = (2 * M * K + 2 * K * N + 2 * M * N + (three ? M * K + K * N + M * N : 0)) * sizeof(T);
+    T* Ar = static_cast<T*>(ctx.allocator().acquire(std::max<size_t>(1, planeBytes)));
+    T* Ai = Ar + M * K;
+    T* Br = Ai + M * K;
+    T* Bi = Br + K * N;
+    T* Cr = Bi + K * N;
+    T* Ci = Cr + M * N;
+    T* As = Ci + M * N;
+    T* Bs = As + M * K;
+    T* P = Bs + K * N;
+
+    parallelRows(ctx, opts.backend, threads, std::max(M, K), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (i < M) {
+                for (size_t k = 0; k < K; k++) {
+                    const std::complex<T> a = A.row(i)[k];
+                    Ar[i * K + k] = a.real();
+                    Ai[i * K + k] = a.imag();
+                    if (three) {
+                        As[i * K + k] = a.real() + a.imag();
+                    }
+                }
+            }
+            if (i < K) {
+                for (size_t j = 0; j < N; j++) {
+                    const std::complex<T> b = B.row(i)[j];
+                    Br[i * N + j] = b.real();
+                    Bi[i * N + j] = b.imag();
+                    if (three) {
+                        Bs[i * N + j] = b.real() + b.imag();
+                    }
+                }
+            }
+        }
+    });
+
+    Options<T> plain;
+    plain.algorithm = opts.algorithm;
+    plain.backend = opts.backend;
+    plain.threads = threads;
+    auto real = [&](const T* X, size_t rows, size_t inner, const T* Y, T* Z, const Options<T>& options) {
+        gemm<T>(ctx, view(X, rows, inner), view(Y, inner, N), view(Z, rows, N), options);
+    };
+
+    if (three) {
+        real(Ar, M, K, Br, Cr, plain);
+        real(Ai, M, K, Bi, P, plain);
+        real(As, M, K, Bs, Ci, plain);
+    } else {
+        Epilogue<T> subtract{-1, 1}, add{1, 1};
+        Options<T> minus = plain, plus = plain;
+        minus.ep = &subtract;
+        plus.ep = &add;
+        real(Ar, M, K, Br, Cr, plain);
+        real(Ai, M, K, Bi, Cr, minus);
+        real(Ar, M, K, Bi, Ci, plain);
+        real(Ai, M, K, Br, Ci, plus);
+    }
+
+    parallelRows(ctx, opts.backend, threads, M, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < N; j++) {
+                const size_t e = i * N + j;
+                if (three) {
+                    C.row(i)[j] = {Cr[e] - P[e], Ci[e] - Cr[e] - P[e]};
+                } else {
+                    C.row(i)[j] = {Cr[e], Ci[e]};
+                }
+            }
+        }
+    });
+    ctx.allocator().release(Ar);
+}
+
+}  // namespace gemm
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "MatrixEpilogue.hpp"
+
+// Compressed sparse row storage
+template <typename T>
+struct CSRMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<size_t> rowPtr;     // rows + 1 offsets into colIdx/values
+    std::vector<size_t> colIdx;
+    std::vector<T> values;
+
+    size_t nnz() const { return values.size(); }
+};
+
+// Block sparse row storage: dense blockSize x blockSize blocks, stored row-major
+// inside each block. Edge blocks are zero padded when blockSize does not divide the size.
+template <typename T>
+struct BSRMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    size_t blockSize = 0;
+    size_t blockRows = 0;
+    size_t blockCols = 0;
+    std::vector<size_t> rowPtr;     // blockRows + 1 offsets into colIdx
+    std::vector<size_t> colIdx;     // block column of each stored block
+    std::vector<T> values;          // blockSize * blockSize values per stored block
+
+    size_t numBlocks() const { return colIdx.size(); }
+};
+
+// One thread's share of a SpGEMM result, concatenated after the join
+template <typename T>
+struct CSRPart {
+    std::vector<size_t> rowNnz;
+    std::vector<size_t> colIdx;
+    std::vector<T> values;
+};
+
+template <typename T>
+struct SparseThreadData {
+    const CSRMatrix<T>* A;
+    const BSRMatrix<T>* A_bsr;
+    const CSRMatrix<T>* B_csr;      // right operand of SpGEMM
+    T** B;                          // right operand of SpMM
+    T** C;
+    CSRPart<T>* C_part;
+    size_t startRow;                // block rows for BSR, rows otherwise
+    size_t endRow;
+    size_t NUM_ARR;
+    const Epilogue<T>* ep = nullptr;    // SpMM only; SpGEMM keeps a plain sparse result
+};
+
+template <typename T>
+CSRMatrix<T> toCSR(T** M, const size_t ROW, const size_t COL) {
+    CSRMatrix<T> S;
+    S.rows = ROW;
+    S.cols = COL;
+    S.rowPtr.resize(ROW + 1);
+    S.rowPtr[0] = 0;
+    for (size_t i = 0; i < ROW; i++) {
+        for (size_t j = 0; j < COL; j++) {
+            if (M[i][j] != T(0)) {
+                S.colIdx.push_back(j);
+                S.values.push_back(M[i][j]);
+            }
+        }
+        S.rowPtr[i + 1] = S.values.size();
+    }
+    return S;
+}
+
+template <typename T>
+BSRMatrix<T> toBSR(T** M, const size_t ROW, const size_t COL, const size_t blockSize) {
+    BSRMatrix<T> S;
+    S.rows = ROW;
+    S.cols = COL;
+    S.blockSize = blockSize;
+    S.blockRows = (ROW + blockSize - 1) / blockSize;
+    S.blockCols = (COL + blockSize - 1) / blockSize;
+    S.rowPtr.resize(S.blockRows + 1);
+    S.rowPtr[0] = 0;
+
+    for (size_t bi = 0; bi < S.blockRows; bi++) {
+        size_t rowEnd = std::min(ROW, (bi + 1) * blockSize);
+        for (size_t bj = 0; bj < S.blockCols; bj++) {
+            size_t colEnd = std::min(COL, (bj + 1) * blockSize);
+            bool nonzero = false;
+            for (size_t i = bi * blockSize; i < rowEnd && !nonzero; i++) {
+                for (size_t j = bj * blockSize; j < colEnd; j++) {
+                    if (M[i][j] != T(0)) {
+                        nonzero = true;
+                        break;
+                    }
+                }
+            }
+            if (!nonzero) {
+                continue;
+            }
+            S.colIdx.push_back(bj);
+            size_t base = S.values.size();
+            S.values.resize(base + blockSize * blockSize, T(0));
+            for (size_t i = bi * blockSize; i < rowEnd; i++) {
+                for (size_t j = bj * blockSize; j < colEnd; j++) {
+                    S.values[base + (i - bi * blockSize) * blockSize + (j - bj * blockSize)] = M[i][j];
+                }
+            }
+        }
+        S.rowPtr[bi + 1] = S.colIdx.size();
+    }
+    return S;
+}
+
+// C = A * B with A in CSR and B dense; each stored A[i][k] scales row k of B into row i of C
+template <typename T>
+void* CSR_SpMM(void* arg) {
+    auto* data = static_cast<SparseThreadData<T>*>(arg);
+    const CSRMatrix<T>& A = *data->A;
+    const size_t N = data->NUM_ARR;
+
+    for (size_t i = data->startRow; i < data->endRow; i++) {
+        T* __restrict c = data->C[i];
+        epilogueRowBegin(data->ep, c, N);
+        for (size_t p = A.rowPtr[i]; p < A.rowPtr[i + 1]; p++) {
+            const T a = epilogueScale(data->ep, A.values[p]);
+            const T* __restrict b = data->B[A.colIdx[p]];
+            for (size_t j = 0; j < N; j++) {
+                c[j] += a * b[j];
+            }
+        }
+        epilogueRowEnd(data->ep, c, N);
+    }
+    return nullptr;
+}
+
+// C = A * B with A in BSR and B dense; the thread range is in block rows
+template <typename T>
+void* BSR_SpMM(void* arg) {
+    auto* data = static_cast<SparseThreadData<T>*>(arg);
+    const BSRMatrix<T>& A = *data->A_bsr;
+    const size_t N = data->NUM_ARR;
+    const size_t bs = A.blockSize;
+
+    for (size_t bi = data->startRow; bi < data->endRow; bi++) {
+        size_t rowBegin = bi * bs;
+        size_t rowEnd = std::min(A.rows, rowBegin + bs);
+        for (size_t i = rowBegin; i < rowEnd; i++) {
+            epilogueRowBegin(data->ep, data->C[i], N);
+        }
+        for (size_t p = A.rowPtr[bi]; p < A.rowPtr[bi + 1]; p++) {
+            const T* block = &A.values[p * bs * bs];
+            size_t colBegin = A.colIdx[p] * bs;
+            size_t colEnd = std::min(A.cols, colBegin + bs);
+            for (size_t i = rowBegin; i < rowEnd; i++) {
+                T* __restrict c = data->C[i];
+                const T* a = block + (i - rowBegin) * bs;
+                for (size_t k = colBegin; k < colEnd; k++) {
+                    const T aik = epilogueScale(data->ep, a[k - colBegin]);
+                    if (aik == T(0)) {
+                        continue;
+                    }
+                    const T* __restrict b = data->B[k];
+                    for (size_t j = 0; j < N; j++) {
+                        c[j] += aik * b[j];
+                    }
+                }
+            }
+        }
+        for (size_t i = rowBegin; i < rowEnd; i++) {
+            epilogueRowEnd(data->ep, data->C[i], N);
+        }
+    }
+    return nullptr;
+}
+
+// C = A * B with both operands in CSR (Gustavson). Each thread accumulates its rows
+// in a dense scratch row and appends the nonzeros to its own CSRPart.
+template <typename T>
+void* CSR_SpGEMM(void* arg) {
+    auto* data = static_cast<SparseThreadData<T>*>(arg);
+    const CSRMatrix<T>& A = *data->A;
+    const CSRMatrix<T>& B = *data->B_csr;
+    CSRPart<T>& out = *data->C_part;
+
+    std::vector<T> acc(B.cols, T(0));
+    std::vector<size_t> marker(B.cols, static_cast<size_t>(-1));
+    std::vector<size_t> touched;
+    out.rowNnz.assign(data->endRow - data->startRow, 0);
+    out.colIdx.clear();
+    out.values.clear();
+
+    for (size_t i = data->startRow; i < data->endRow; i++) {
+        touched.clear();
+        for (size_t p = A.rowPtr[i]; p < A.rowPtr[i + 1]; p++) {
+            const T a = A.values[p];
+            size_t k = A.colIdx[p];
+            for (size_t q = B.rowPtr[k]; q < B.rowPtr[k + 1]; q++) {
+                size_t j = B.colIdx[q];
+                if (marker[j] != i) {
+                    marker[j] = i;
+                    acc[j] = T(0);
+                    touched.push_back(j);
+                }
+                acc[j] += a * B.values[q];
+            }
+        }
+        std::sort(touched.begin(), touched.end());
+        for (size_t j : touched) {
+            out.colIdx.push_back(j);
+            out.values.push_back(acc[j]);
+        }
+        out.rowNnz[i - data->startRow] = touched.size();
+    }
+    return nullptr;
+}
+
+// Concatenate the per-thread SpGEMM parts (in row order) into one CSR matrix
+template <typename T>
+CSRMatrix<T> assembleCSR(std::vector<CSRPart<T>>& parts, const size_t ROW, const size_t COL) {
+    CSRMatrix<T> S;
+    S.rows = ROW;
+    S.cols = COL;
+    S.rowPtr.reserve(ROW + 1);
+    S.rowPtr.push_back(0);
+    size_t total = 0;
+    for (const CSRPart<T>& part : parts) {
+        total += part.values.size();
+    }
+    S.colIdx.reserve(total);
+    S.values.reserve(total);
+    for (CSRPart<T>& part : parts) {
+        for (size_t n : part.rowNnz) {
+            S.rowPtr.push_back(S.rowPtr.back() + n);
+        }
+        S.colIdx.insert(S.colIdx.end(), part.colIdx.begin(), part.colIdx.end());
+        S.values.insert(S.values.end(), part.values.begin(), part.values.end());
+    }
+    return S;
+}
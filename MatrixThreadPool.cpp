@@ -0,0 +1,106 @@
+#include "MatrixThreadPool.hpp"
+
+namespace {
+thread_local int currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(int threads, size_t queueCapacity) : queue(queueCapacity) {
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back([this, t]() { workerLoop(t); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stopping.store(true);
+    wakeups.fetch_add(1);
+    wakeups.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::workerIndex() {
+    return currentWorker;
+}
+
+void ThreadPool::execute(const Task& task) {
+    (*task.body)(task.index);
+    task.latch->countDown();
+}
+
+// Pairs with the sleepers increment in workerLoop: after the fence either this thread sees
+// the sleeper, or the sleeper's re-check of the queue sees the task just pushed
+void ThreadPool::wakeWorkers() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+        wakeups.fetch_add(1, std::memory_order_release);
+        wakeups.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    CountdownLatch latch(static_cast<std::ptrdiff_t>(count));
+
+    Task pending;
+    for (size_t index = 0; index < count; index++) {
+        Task next{&task, index, &latch};
+        // A full ring means the workers are behind: run queued work here until one slot frees
+        while (!queue.tryPush(next)) {
+            wakeWorkers();
+            if (queue.tryPop(pending)) {
+                execute(pending);
+            }
+        }
+        if ((index & 15) == 0) {
+            wakeWorkers();
+        }
+    }
+    wakeWorkers();
+
+    while (!latch.tryWait()) {
+        if (queue.tryPop(pending)) {
+            execute(pending);
+        } else {
+            latch.wait();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int index) {
+    currentWorker = index;
+    Task task;
+    for (;;) {
+        if (queue.tryPop(task)) {
+            execute(task);
+            continue;
+        }
+
+        bool found = false;
+        for (int spin = 0; spin < SPIN_LIMIT && !found; spin++) {
+            cpuRelax();
+            found = queue.tryPop(task);
+        }
+        if (found) {
+            execute(task);
+            continue;
+        }
+
+        uint32_t seen = wakeups.load(std::memory_order_acquire);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue.tryPop(task)) {
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            execute(task);
+            continue;
+        }
+        if (stopping.load()) {
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+        wakeups.wait(seen, std::memory_order_acquire);
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "MatrixLockFree.hpp"
+
+// Fixed set of worker threads owned by a gemm::Context. run() pushes one task per index
+// onto a lock-free MPMC ring shared by all jobs, helps run tasks itself, and returns when
+// its countdown latch reaches zero. Idle workers spin, then park on a wake-up counter that
+// producers only touch when someone is actually parked. Several callers may run jobs at
+// the same time.
+class ThreadPool {
+public:
+    // threads counts the calling thread, so threads - 1 workers are started
+    explicit ThreadPool(int threads, size_t queueCapacity = 4096);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // 1..size()-1 on the pool's workers, 0 on any other thread
+    static int workerIndex();
+
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    struct Task {
+        const std::function<void(size_t)>* body = nullptr;
+        size_t index = 0;
+        CountdownLatch* latch = nullptr;
+    };
+
+    static void execute(const Task& task);
+    void wakeWorkers();
+    void workerLoop(int index);
+
+    MpmcRing<Task> queue;
+    std::vector<std::thread> workers;
+    std::atomic<uint32_t> wakeups{0};
+    std::atomic<int> sleepers{0};
+    std::atomic<bool> stopping{false};
+};
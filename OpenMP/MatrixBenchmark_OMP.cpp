@@ -5,6 +5,12 @@
 #include <thread>
 #include <omp.h>
 #include <functional>
+#include "../MatrixEpilogue.hpp"
+#include "../MatrixDispatch.hpp"
+#include "../MatrixCounters.hpp"
+#include "../MatrixPower.hpp"
+#include "../MatrixBuild.hpp"
+#include "../MatrixScaling.hpp"
 
 // Function to generate random matrix elements
 template<typename T>
@@ -29,72 +35,146 @@ void generate_matrix_element(T** matrix, const size_t ROW, const size_t COL) {
     }    
 }
 
+// Stride between the rows of a matrix from allocate_matrix, which stores them back to back
+template<typename T>
+size_t row_stride(T** M, const size_t ROW, const size_t COL) {
+    return ROW > 1 ? static_cast<size_t>(M[1] - M[0]) : COL;
+}
+
 // Parallel matrix multiplication(Row x Column) (A * B = C) using OpenMP
+// i-k-j order; each C strip is accumulated in registers and stored once, in the kernel
+// variant dispatched for this CPU (MatrixDispatch.hpp)
+// NUMTHREAD = 0 leaves 1-2 threads for the OS, otherwise exactly NUMTHREAD threads run (all four kernels)
+template<typename T>
+void matrix_product_rc(T** __restrict A, T** __restrict B, T** __restrict C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0, const Epilogue<T>* ep=nullptr) {
+    size_t cpu_units = omp_get_max_threads();
+    cpu_units = (cpu_units > 2) ? cpu_units - 2 : 1; // leaves 1-2 thread for OS
+    if (NUMTHREAD > 0)
+        cpu_units = NUMTHREAD;
+
+    const RowKernels<T>& kernels = rowKernels<T>();
+    const size_t ldb = row_stride(B, COL, COL);
+    #pragma omp parallel for schedule(static) num_threads(cpu_units)
+    for (size_t i = 0; i < ROW; ++i) {
+        kernels.ikj(A[i], B[0], ldb, C[i], COL, COL, ep); // Row × Column multiplication
+    }
+}
+
+// Parallel matrix multiplication(Row x Row) (A * B = C) using OpenMP
+// four dot products at a time with the sums held in registers (MatrixDispatch.hpp)
+template<typename T>
+void matrix_product_rr(T** __restrict A, T** __restrict B, T** __restrict C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0, const Epilogue<T>* ep=nullptr) {
+    size_t cpu_units = omp_get_max_threads();
+    cpu_units = (cpu_units > 2) ? cpu_units - 2 : 1; // leaves 1-2 thread for OS
+    if (NUMTHREAD > 0)
+        cpu_units = NUMTHREAD;
+
+    const RowKernels<T>& kernels = rowKernels<T>();
+    const size_t ldb = row_stride(B, COL, COL);
+    #pragma omp parallel for schedule(static) num_threads(cpu_units)
+    for (size_t i = 0; i < ROW; ++i) {
+        kernels.rr(A[i], B[0], ldb, C[i], COL, COL, ep); // Row × Row multiplication
+    }
+}
+
+// Previous Row x Column kernel that accumulates into C[i][j] in memory, kept as the
+// baseline for the "traffic" report
 template<typename T>
-void matrix_product_rc(T** A, T** B, T** C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0) {
-    // std::cout << "ID: " << std::this_thread::get_id() << " Start: " << START << " End: " << END << std::endl;
+void matrix_product_rc_naive(T** A, T** B, T** C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0, const Epilogue<T>* ep=nullptr) {
     int i,j,k;
     size_t cpu_units = omp_get_max_threads();
-    // std::cout << "Using " << cpu_units << " threads." << std::endl;
     cpu_units = (cpu_units > 2) ? cpu_units - 2 : 1; // leaves 1-2 thread for OS
+    if (NUMTHREAD > 0)
+        cpu_units = NUMTHREAD;
 
     #pragma omp parallel for shared(A, B, C) private(i, j, k) schedule(static) num_threads(cpu_units)
     for (i = 0; i < ROW; ++i) {
         for (j = 0; j < COL; ++j) {
+            T old = C[i][j];
             C[i][j] = 0;
             for (k = 0; k < COL; ++k)  // Use COL for matrix B's row dimension
                 C[i][j] += A[i][k] * B[k][j]; // Row × Column multiplication
+            if (ep)
+                C[i][j] = applyEpilogue(*ep, C[i][j], old, j);
         }
     }
 }
 
-// Parallel matrix multiplication(Row x Row) (A * B = C) using OpenMP
+// Previous Row x Row kernel, baseline for the "traffic" report
 template<typename T>
-void matrix_product_rr(T** A, T** B, T** C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0) {
-    // std::cout << "ID: " << std::this_thread::get_id() << " Start: " << START << " End: " << END << std::endl;
+void matrix_product_rr_naive(T** A, T** B, T** C, const size_t ROW, const size_t COL, size_t NUMTHREAD=0, const Epilogue<T>* ep=nullptr) {
     int i,j,k;
     size_t cpu_units = omp_get_max_threads();
-    // std::cout << "Using " << cpu_units << " threads." << std::endl;
     cpu_units = (cpu_units > 2) ? cpu_units - 2 : 1; // leaves 1-2 thread for OS
+    if (NUMTHREAD > 0)
+        cpu_units = NUMTHREAD;
 
     #pragma omp parallel for shared(A, B, C) private(i, j, k) schedule(static) num_threads(cpu_units)
     for (i = 0; i < ROW; ++i) {
         for (j = 0; j < COL; ++j) {
+            T old = C[i][j];
             C[i][j] = 0;
             for (k = 0; k < COL; ++k)  // Use COL for matrix B's row dimension
                 C[i][j] += A[i][k] * B[j][k]; // Row × Row multiplication
+            if (ep)
+                C[i][j] = applyEpilogue(*ep, C[i][j], old, j);
         }
     }
 }
 
 // Function for matrix Operation Timer the calculation time
+// "traffic" runs the naive and register-accumulating kernels back to back and returns the rc time
 template<typename T>
-double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL, const std::string& method = "") {
+double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL, PerfCounters& counters, PowerMonitor& power, const std::string& method = "") {
 
-    std::chrono::duration<double> elapsed_time_ms;
+    if (method == "traffic") {
+        double rc_time = 0;
+        for (const char* m : {"rc_naive", "rc", "rr_naive", "rr"}) {
+            double t = operation_matrix(A, B, C, ROW, COL, counters, power, m);
+            if (std::string(m) == "rc")
+                rc_time = t;
+        }
+        return rc_time;
+    }
 
+    void (*product)(T**, T**, T**, size_t, size_t, size_t, const Epilogue<T>*) = nullptr;
+    bool naive = false;
     if (method == "rc") {
-
-        auto start_time = std::chrono::high_resolution_clock::now();
-        matrix_product_rc(A, B, C, ROW, COL);
-        auto end_time = std::chrono::high_resolution_clock::now();
-        elapsed_time_ms = end_time - start_time;
-        std::cout << "[" << typeid(T).name() << "]";
-        std::cout << "Processing Time of " << ROW << 'x' << COL << ": " << elapsed_time_ms.count() << " seconds" << std::endl;
-
+        product = matrix_product_rc<T>;
     } else if (method == "rr") {
-
-        auto start_time = std::chrono::high_resolution_clock::now();
-        matrix_product_rc(A, B, C, ROW, COL);
-        auto end_time = std::chrono::high_resolution_clock::now();
-        elapsed_time_ms = end_time - start_time;
-        std::cout << "[" << typeid(T).name() << "]";
-        std::cout << "Processing Time of " << ROW << 'x' << COL << ": " << elapsed_time_ms.count() << " seconds" << std::endl; 
-
+        product = matrix_product_rr<T>;
+    } else if (method == "rc_naive") {
+        product = matrix_product_rc_naive<T>;
+        naive = true;
+    } else if (method == "rr_naive") {
+        product = matrix_product_rr_naive<T>;
+        naive = true;
     } else {
         std::cerr << "Invalid method specified." << std::endl;
+        return 0;
     }
 
+    power.start();
+    counters.start();
+    auto start_time = std::chrono::high_resolution_clock::now();
+    product(A, B, C, ROW, COL, 0, nullptr);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    counters.stop();
+    PowerReading reading = power.stop();
+
+    std::chrono::duration<double> elapsed_time_ms = end_time - start_time;
+    std::cout << "[" << typeid(T).name() << "]";
+    std::cout << "Processing Time of " << ROW << 'x' << COL << ": " << elapsed_time_ms.count() << " seconds" << std::endl;
+
+    // model of the C traffic: the naive kernels load and store C[i][j] on every k step
+    double c_accesses = naive ? 2.0 * ROW * COL * COL : static_cast<double>(ROW) * COL;
+    std::cout << "    [" << method << "] C accesses (model): " << c_accesses << ", ";
+    counters.print(std::cout);
+    std::cout << std::endl;
+    std::cout << "    [" << method << "] ";
+    PowerMonitor::print(std::cout, reading, 2.0 * ROW * COL * COL);
+    std::cout << std::endl;
+
     return elapsed_time_ms.count();
 }
 
@@ -110,11 +190,13 @@ void print_matrix(T** matrix, const size_t ROW, const size_t COL) {
 }
 
 // Function matrix allocate heap memory for 2D Array
+// The rows are stored back to back so the strided row kernels can reach B from B[0]
 template <typename T>
 T** allocate_matrix(const size_t ROW, const size_t COL) {
     T** matrix = new T*[ROW];
+    T* data = new T[ROW * COL];
     for (size_t row = 0; row < ROW; ++row) {
-        matrix[row] = new T[COL];
+        matrix[row] = data + row * COL;
     }
     return matrix;
 }
@@ -122,15 +204,14 @@ T** allocate_matrix(const size_t ROW, const size_t COL) {
 // Function matrix deallocate heap memory for 2D Array
 template <typename T>
 void deallocate_matrix(T** matrix, const size_t ROW) {
-    for (size_t row = 0; row < ROW; ++row) {
-        delete[] matrix[row];  // Use delete[] for arrays
-    }
+    if (ROW > 0)
+        delete[] matrix[0];  // the rows share one allocation
     delete[] matrix;  // Use delete[] for array of pointers
 }
 
 // Function to create matrix and run matrix operation
 template<typename T>
-void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_times, const std::string& method = "") {
+void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_times, PerfCounters& counters, PowerMonitor& power, const std::string& method = "") {
     T** matrix_A = allocate_matrix<T>(ROW, COL);
     T** matrix_B = allocate_matrix<T>(ROW, COL);
     T** matrix_C = allocate_matrix<T>(ROW, COL);
@@ -138,17 +219,44 @@ void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_tim
     generate_matrix_element(matrix_A, ROW, COL);
     generate_matrix_element(matrix_B, ROW, COL);
 
-    sum_times += operation_matrix(matrix_A, matrix_B, matrix_C, ROW, COL, method);
+    sum_times += operation_matrix(matrix_A, matrix_B, matrix_C, ROW, COL, counters, power, method);
 
     deallocate_matrix(matrix_A, ROW);
     deallocate_matrix(matrix_B, ROW);
     deallocate_matrix(matrix_C, ROW);
 }
 
+// Strong (scale fixed) or weak (scale^3 / threads fixed) scaling of the rc kernel over
+// 1, 2, 4, ... omp_get_max_threads() threads. Matrices are allocated once at the largest
+// size; smaller runs use their top-left corner.
+template<typename T>
+void run_scaling(const size_t SIZE, const int ROUND, ScalingKind kind) {
+    const int max_threads = omp_get_max_threads();
+    const size_t max_size = scalingSize(kind, SIZE, max_threads);
+    T** matrix_A = allocate_matrix<T>(max_size, max_size);
+    T** matrix_B = allocate_matrix<T>(max_size, max_size);
+    T** matrix_C = allocate_matrix<T>(max_size, max_size);
+    generate_matrix_element(matrix_A, max_size, max_size);
+    generate_matrix_element(matrix_B, max_size, max_size);
+
+    auto measure = [&](int threads, size_t n) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        matrix_product_rc(matrix_A, matrix_B, matrix_C, n, n, threads);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double>(end_time - start_time).count();
+    };
+    printScalingTable(std::cout, std::string("omp rc [") + typeid(T).name() + "]", kind,
+                      runScaling(kind, SIZE, max_threads, ROUND, measure));
+
+    deallocate_matrix(matrix_A, max_size);
+    deallocate_matrix(matrix_B, max_size);
+    deallocate_matrix(matrix_C, max_size);
+}
+
 int main(int argc, char* argv[]) {
 
     if (argc < 5 || argc > 5) {
-        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round> <product_method(rc,rr)>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <type> <scale> <round> <product_method(rc,rr,rc_naive,rr_naive,traffic,strong,weak)>" << std::endl;
         return 1;
     }
 
@@ -158,23 +266,46 @@ int main(int argc, char* argv[]) {
     std::string method = argv[4];
 
     double sum_times = 0;
+    printBuildInfo(std::cout);
+
+    ScalingKind kind;
+    if (parseScalingKind(method, kind)) {
+        if (mtype == "int") {
+            run_scaling<int>(SIZE, ROUND, kind);
+        } else if (mtype == "2long") {
+            run_scaling<long long>(SIZE, ROUND, kind);
+        } else if (mtype == "float") {
+            run_scaling<float>(SIZE, ROUND, kind);
+        } else if (mtype == "double") {
+            run_scaling<double>(SIZE, ROUND, kind);
+        } else {
+            std::cerr << "Unsupported type: " << mtype << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    PerfCounters counters;  // opened before the OpenMP pool exists so its threads inherit them
+    PowerMonitor power;
+    power.describe(std::cout);
 
     for(int round = 0; round < ROUND; ++round) {
         std::cout << "ROUND[" << (round+1) << "]: ";
         if (mtype == "int") {
-            create_operation_matrix<int>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<int>(SIZE, SIZE, sum_times, counters, power, method);
         } else if (mtype == "2long") {
-            create_operation_matrix<long long>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<long long>(SIZE, SIZE, sum_times, counters, power, method);
         } else if (mtype == "float") {
-            create_operation_matrix<float>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<float>(SIZE, SIZE, sum_times, counters, power, method);
         } else if (mtype == "double") {
-            create_operation_matrix<double>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<double>(SIZE, SIZE, sum_times, counters, power, method);
         } else {
             std::cerr << "Unsupported type: " << mtype << "\n";
             return 1;
         }
+        // wait for clocks and temperature to settle instead of a fixed 7 s cool-down
         if(round < (ROUND-1))
-            std::this_thread::sleep_for(std::chrono::seconds(7));
+            std::cout << "Settled after " << power.settle() << " seconds" << std::endl;
     }
 
     std::cout << "[" << method << "]" << "Average time: " << (sum_times / ROUND) << " seconds" << std::endl;
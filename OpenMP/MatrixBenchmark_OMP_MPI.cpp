@@ -1,9 +1,16 @@
 #include <iostream>
 #include <omp.h>
 #include <mpi.h>
+#include <string>
 #include <vector>
 #include <chrono>
 #include <random>
+#include "../MatrixEpilogue.hpp"
+#include "../MatrixDispatch.hpp"
+#include "../MatrixCounters.hpp"
+#include "../MatrixBuild.hpp"
+#include "../MatrixScaling.hpp"
+#include "../MatrixCommMpi.hpp"
 
 // Function to generate matrix elements
 template<typename T>
@@ -22,16 +29,63 @@ void generate_matrix_element(T* matrix, size_t ROW, size_t COL) {
 }
 
 // Function to multiply matrices
+// i-k-j with each C strip accumulated in registers and stored once, in the kernel variant
+// dispatched for this CPU (MatrixDispatch.hpp)
 template <typename T>
-void matrix_product_rc(T* A, T* B, T* C, const size_t ROW, const size_t COL) {
-    #pragma omp parallel for
+void matrix_product_rc(const T* __restrict A, const T* __restrict B, T* __restrict C, const size_t ROW, const size_t COL, const Epilogue<T>* ep = nullptr) {
+    const RowKernels<T>& kernels = rowKernels<T>();
+    #pragma omp parallel for schedule(static)
     for (size_t i = 0; i < ROW; ++i) {
-        for (size_t j = 0; j < COL; ++j) {
-            C[i * COL + j] = 0;
-            for (size_t k = 0; k < COL; ++k) {
-                C[i * COL + j] += A[i * COL + k] * B[k * COL + j];
-            }
+        kernels.ikj(A + i * COL, B, COL, C + i * COL, COL, COL, ep);
+    }
+}
+
+// Strong or weak scaling over 1, 2, 4, ... of the launched ranks, one OpenMP thread each.
+// The first p ranks are split off into their own communicator, and every timed product
+// includes the scatter of A, the broadcast of B and the gather of C, as in the full run.
+// Buffers are allocated once for the largest size.
+void run_scaling(ScalingKind kind, const size_t SIZE, const int ROUND, int rank, int size) {
+    omp_set_num_threads(1);
+    const size_t max_n = scalingSize(kind, SIZE, size);
+    const size_t max_elements = (max_n + size) * max_n;
+    std::vector<double> A, C;
+    std::vector<double> B(max_n * max_n), local_A(max_elements), local_C(max_elements);
+    if (rank == 0) {
+        A.resize(max_elements);
+        C.resize(max_elements);
+        generate_matrix_element(A.data(), max_n, max_n);
+        generate_matrix_element(B.data(), max_n, max_n);
+    }
+
+    MPI_Comm sub = MPI_COMM_NULL;
+    int sub_ranks = 0;
+    auto measure = [&](int ranks, size_t n) {
+        if (ranks != sub_ranks) {  // every rank sees the same sequence, so the split stays collective
+            if (sub != MPI_COMM_NULL)
+                MPI_Comm_free(&sub);
+            MPI_Comm_split(MPI_COMM_WORLD, rank < ranks ? 0 : MPI_UNDEFINED, rank, &sub);
+            sub_ranks = ranks;
         }
+        if (sub == MPI_COMM_NULL)
+            return 0.0;
+
+        const size_t rows_per_process = (n + ranks - 1) / ranks;
+        const int count = static_cast<int>(rows_per_process * n);
+        MPI_Barrier(sub);
+        double start = MPI_Wtime();
+        MPI_Scatter(A.data(), count, MPI_DOUBLE, local_A.data(), count, MPI_DOUBLE, 0, sub);
+        MPI_Bcast(B.data(), static_cast<int>(n * n), MPI_DOUBLE, 0, sub);
+        matrix_product_rc(local_A.data(), B.data(), local_C.data(), rows_per_process, n);
+        MPI_Gather(local_C.data(), count, MPI_DOUBLE, C.data(), count, MPI_DOUBLE, 0, sub);
+        return MPI_Wtime() - start;
+    };
+    std::vector<ScalingPoint> points = runScaling(kind, SIZE, size, ROUND, measure);
+    if (sub != MPI_COMM_NULL)
+        MPI_Comm_free(&sub);
+
+    if (rank == 0) {
+        printBuildInfo(std::cout);
+        printScalingTable(std::cout, "mpi ranks", kind, points);
     }
 }
 
@@ -39,6 +93,34 @@ int main(int argc, char** argv) {
     auto start_time = std::chrono::high_resolution_clock::now();
     MPI_Init(&argc, &argv);
 
+    // comm [scale] [round] [panel]: the pipelined product through MpiComm, with per-rank
+    // bytes moved and overlap; matrix_ranks runs the same code with emulated ranks
+    if (argc >= 2 && std::string(argv[1]) == "comm") {
+        MpiComm comm;
+        const size_t scale = argc >= 3 ? std::stoul(argv[2]) : 1024;
+        const int round = argc >= 4 ? std::stoi(argv[3]) : 3;
+        const size_t panel = argc >= 5 ? std::stoul(argv[4]) : std::max<size_t>(1, scale / 8);
+        if (comm.rank() == 0) {
+            printBuildInfo(std::cout);
+        }
+        benchmarkDistributed(comm, scale, round, panel, std::cout);
+        MPI_Finalize();
+        return 0;
+    }
+
+    ScalingKind kind;
+    if (argc >= 2 && parseScalingKind(argv[1], kind)) {
+        int rank, size;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+        const size_t scale = argc >= 3 ? std::stoul(argv[2]) : 1024;
+        const int round = argc >= 4 ? std::stoi(argv[3]) : 3;
+        run_scaling(kind, scale, round, rank, size);
+        MPI_Finalize();
+        return 0;
+    }
+    PerfCounters counters;  // before the first parallel region so the OpenMP threads inherit it
+
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -72,7 +154,9 @@ int main(int argc, char** argv) {
         MPI_Bcast(B, N * N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
     }
 
+    counters.start();
     matrix_product_rc(local_A, B, local_C, rows_per_process, N);
+    counters.stop();
 
     MPI_Gather(local_C, rows_per_process * N, MPI_DOUBLE, C, rows_per_process * N, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
@@ -101,7 +185,11 @@ int main(int argc, char** argv) {
 
     // Timing calculations
     if (rank == 0) {
+        printBuildInfo(std::cout);
         std::cout << "Total Execution: " << std::chrono::duration<double>(end_time - start_time).count() << std::endl;
+        std::cout << "Rank 0 kernel counters: ";
+        counters.print(std::cout);
+        std::cout << std::endl;
     }
 
     return 0;
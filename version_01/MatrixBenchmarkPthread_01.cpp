@@ -4,6 +4,7 @@
 #include <chrono>
 #include <thread>
 #include <functional>
+#include "../MatrixPower.hpp"
 
 // Function to generate random matrix elements
 template<typename T>
@@ -58,7 +59,7 @@ void matrix_product_rr(T** A, T** B, T** C, const size_t ROW, const size_t COL,
 
 // Function for matrix Operation Timer the calculation time
 template<typename T>
-double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL, size_t NUMTHREAD = 0, const std::string& method = "") {
+double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL, PowerMonitor& power, size_t NUMTHREAD = 0, const std::string& method = "") {
     size_t cpu_units = NUMTHREAD == 0 ? std::thread::hardware_concurrency() : NUMTHREAD;
     // std::cout << "Using " << cpu_units << " threads." << std::endl;
     cpu_units = (cpu_units > 2) ? cpu_units - 2 : 1; // leaves 1-2 thread for OS
@@ -74,6 +75,7 @@ double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL,
         return -1;
     }
     
+    power.start();
     auto start_time = std::chrono::high_resolution_clock::now();
 
     std::vector<std::thread> threads;
@@ -103,9 +105,13 @@ double operation_matrix(T** A, T** B, T** C, const size_t ROW, const size_t COL,
     }
 
     auto end_time = std::chrono::high_resolution_clock::now();
+    PowerReading reading = power.stop();
     std::chrono::duration<double> elapsed_time_ms = end_time - start_time;
     std::cout << "[" << typeid(T).name() << "]";
     std::cout << "Processing Time of " << ROW << 'x' << COL << ": " << elapsed_time_ms.count() << " seconds" << std::endl;
+    std::cout << "    ";
+    PowerMonitor::print(std::cout, reading, 2.0 * ROW * COL * COL);
+    std::cout << std::endl;
 
     return elapsed_time_ms.count();
 }
@@ -142,7 +148,7 @@ void deallocate_matrix(T** matrix, const size_t ROW) {
 
 // Function to create matrix and run matrix operation
 template<typename T>
-void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_times, const std::string& method = "") {
+void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_times, PowerMonitor& power, const std::string& method = "") {
     T** matrix_A = allocate_matrix<T>(ROW, COL);
     T** matrix_B = allocate_matrix<T>(ROW, COL);
     T** matrix_C = allocate_matrix<T>(ROW, COL);
@@ -150,7 +156,7 @@ void create_operation_matrix(const size_t ROW, const size_t COL, double& sum_tim
     generate_matrix_element(matrix_A, ROW, COL);
     generate_matrix_element(matrix_B, ROW, COL);
 
-    sum_times += operation_matrix(matrix_A, matrix_B, matrix_C, ROW, COL, 0, method);
+    sum_times += operation_matrix(matrix_A, matrix_B, matrix_C, ROW, COL, power, 0, method);
     // print_matrix(matrix_C, ROW, COL);
 
     deallocate_matrix(matrix_A, ROW);
@@ -171,23 +177,26 @@ int main(int argc, char* argv[]) {
     std::string method = argv[4];
 
     double sum_times = 0;
+    PowerMonitor power;
+    power.describe(std::cout);
 
     for(int round = 0; round < ROUND; ++round) {
         std::cout << "ROUND[" << (round+1) << "]: ";
         if (mtype == "int") {
-            create_operation_matrix<int>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<int>(SIZE, SIZE, sum_times, power, method);
         } else if (mtype == "2long") {
-            create_operation_matrix<long long>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<long long>(SIZE, SIZE, sum_times, power, method);
         } else if (mtype == "float") {
-            create_operation_matrix<float>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<float>(SIZE, SIZE, sum_times, power, method);
         } else if (mtype == "double") {
-            create_operation_matrix<double>(SIZE, SIZE, sum_times, method);
+            create_operation_matrix<double>(SIZE, SIZE, sum_times, power, method);
         } else {
             std::cerr << "Unsupported type: " << mtype << "\n";
             return 1;
         }
+        // wait for clocks and temperature to settle instead of a fixed 7 s cool-down
         if(round < (ROUND-1))
-            std::this_thread::sleep_for(std::chrono::seconds(7));
+            std::cout << "Settled after " << power.settle() << " seconds" << std::endl;
     }
 
     std::cout << "[" << method << "]" << "Average time: " << (sum_times / ROUND) << " seconds" << std::endl;